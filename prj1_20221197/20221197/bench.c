@@ -0,0 +1,1109 @@
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <stdbool.h>
+ #include <stddef.h>
+ #include <stdint.h>
+ #include <time.h>
+ #include <math.h>
+ #include <pthread.h>
+ #include "bitmap.h"
+ #include "bitalloc.h"
+ #include "bloom.h"
+ #include "buddy.h"
+ #include "fbitmap.h"
+ #include "simd.h"
+ #include "hash.h"
+ 
+ /* 상수 정의 */
+ #define MAX_THREADS 32
+ #define ALLOC_BITS (1 << 16)     // 할당 벤치마크에 사용하는 비트맵 크기
+ #define ALLOC_OPS 200000         // 스레드 수와 무관한 전체 할당 횟수
+ #define ALLOC_HELD 16            // 스레드마다 동시에 보유하는 할당 수
+ #define ALLOC_MAX_RUN 8          // 한 번에 할당하는 최대 비트 수
+ #define SIMD_BITS (64 << 20)     // SIMD 벤치마크에 사용하는 비트맵 크기 (8MB)
+ #define SIMD_REPEAT 20           // 각 연산의 반복 횟수
+ #define RANK_BITS (1 << 26)      // rank/select 벤치마크에 사용하는 비트맵 크기
+ #define RANK_QUERIES 1000000     // rank 디렉터리를 사용할 때의 질의 횟수
+ #define RANK_SCAN_QUERIES 20     // 처음부터 세는 방식의 질의 횟수
+ #define BUDDY_UNITS (1 << 20)    // 버디 벤치마크에서 관리하는 범위의 크기
+ #define BUDDY_MAX_ORDER 8        // 한 번에 할당하는 최대 크기 (2^8)
+ #define BUDDY_HELD 15000         // 동시에 보유하는 할당 수 (범위의 약 80%)
+ #define BUDDY_OPS 50000          // 해제 후 다시 할당하는 횟수
+ #define FIXED_BITS 256           // 고정 크기 비트맵 벤치마크의 비트맵 크기
+ #define FIXED_OPS 5000000        // 각 비트맵에서 반복하는 연산 횟수
+ #define BLOOM_KEYS (1 << 20)     // 블룸 필터에 삽입하는 키 수
+ #define BLOOM_BITS_PER_KEY 10    // 키 하나당 블룸 필터 비트 수
+ #define SNAPSHOT_BITS (1 << 28)  // 스냅샷 벤치마크에 사용하는 비트맵 크기 (32MB)
+ #define SNAPSHOT_WRITES 1000000  // 스냅샷 이후 수행하는 무작위 쓰기 횟수
+ #define HASH_SLOTS (1 << 20)     // 해시 벤치마크의 부하율 기준이 되는 슬롯 수
+ #define HASH_QUERIES 2000000     // 적중/실패 각각의 조회 횟수
+ #define REHASH_KEYS (1 << 22)    // 재해싱 벤치마크에서 삽입하는 키 수
+ #define REHASH_SLOW_NS 10000     // 느린 삽입으로 집계하는 기준 시간 (10us)
+ #define STRHASH_KEYS (1 << 18)   // 문자열 해시 벤치마크의 키 수
+ #define STRHASH_LEN 48           // 문자열 키의 길이
+ #define COUNT_KEYS (1 << 16)     // 빈도 세기 벤치마크의 서로 다른 키 수
+ #define COUNT_OPS (1 << 17)      // 빈도 세기 벤치마크에서 한 번에 세는 키의 수 (약 40%가 새 키)
+ #define COUNT_ROUNDS 30          // 빈 테이블에서 다시 세는 횟수
+ #define HASHMEM_QUERIES 2000000  // 메모리 벤치마크에서 테이블마다 수행하는 조회 횟수
+ #define HASHFN_BYTES (64 << 20)  // 해시 함수 벤치마크에서 길이마다 해싱하는 전체 바이트 수
+ #define SEED_KEYS 20000          // 시드 벤치마크에서 삽입하는 키 수
+ #define DIST_KEYS (1 << 16)      // 해시 분포 벤치마크의 키 집합마다의 키 수
+ #define DIST_REPEAT 100          // 해싱 시간을 잴 때 키 집합을 해싱하는 횟수
+ #define DIST_QUERIES 2000000     // 해시 분포 벤치마크의 조회 횟수
+ 
+ /* ---------------------- */
+ /*    유틸리티 함수들     */
+ /* ---------------------- */
+ 
+ /*
+  * now_sec:
+  *   - 단조 증가 시계의 현재 시각을 초 단위로 반환.
+  */
+ static double now_sec(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return ts.tv_sec + ts.tv_nsec / 1e9;
+ }
+ 
+ /*
+  * next_random:
+  *   - 스레드별 상태를 사용하는 xorshift 난수 생성기.
+  *   - rand()는 스레드 간에 공유되므로 벤치마크에서는 사용하지 않음.
+  */
+ static uint32_t next_random(uint32_t *state) {
+     uint32_t x = *state;
+     x ^= x << 13;
+     x ^= x >> 17;
+     x ^= x << 5;
+     return *state = x;
+ }
+ 
+ /*
+  * run_threads:
+  *   - thread_count개의 스레드에서 func을 실행하고 모두 끝날 때까지 걸린 시간(초)을 반환.
+  *   - 각 스레드에는 0부터 시작하는 스레드 번호가 인자로 전달됨.
+  */
+ static double run_threads(int thread_count, void *(*func)(void *)) {
+     pthread_t threads[MAX_THREADS];
+     double start = now_sec();
+     for (intptr_t t = 0; t < thread_count; t++)
+         pthread_create(&threads[t], NULL, func, (void *)t);
+     for (int t = 0; t < thread_count; t++)
+         pthread_join(threads[t], NULL);
+     return now_sec() - start;
+ }
+ 
+ /* ---------------------- */
+ /*  비트맵 할당 벤치마크   */
+ /* ---------------------- */
+ 
+ /* 할당 방식 */
+ enum alloc_mode {
+     ALLOC_MUTEX,       // 전역 뮤텍스 + bitmap_scan_and_flip
+     ALLOC_LOCKFREE,    // 하나의 비트맵에 bitmap_scan_and_flip_atomic
+     ALLOC_SHARDED,     // 스레드마다 홈 샤드를 갖는 bitalloc
+     ALLOC_MODE_COUNT
+ };
+ static const char *alloc_mode_names[ALLOC_MODE_COUNT] = { "mutex", "lockfree", "sharded" };
+ 
+ /* 할당 벤치마크 공유 상태 */
+ static struct bitmap *alloc_bmp;
+ static struct bitalloc *alloc_shards;
+ static pthread_mutex_t alloc_lock = PTHREAD_MUTEX_INITIALIZER;
+ static enum alloc_mode alloc_mode;
+ static int alloc_threads;
+ static uint8_t alloc_owner[ALLOC_BITS];      // 각 비트를 할당받은 스레드 번호 + 1
+ static volatile bool alloc_conflict;         // 두 스레드가 같은 비트를 할당받았는지 여부
+ 
+ /*
+  * alloc_run / free_run:
+  *   - 현재 할당 방식(alloc_mode)으로 cnt 비트를 할당하거나 해제.
+  */
+ static size_t alloc_run(size_t cnt) {
+     size_t idx;
+     switch (alloc_mode) {
+     case ALLOC_MUTEX:
+         pthread_mutex_lock(&alloc_lock);
+         idx = bitmap_scan_and_flip(alloc_bmp, 0, cnt, false);
+         pthread_mutex_unlock(&alloc_lock);
+         return idx;
+     case ALLOC_LOCKFREE:
+         return bitmap_scan_and_flip_atomic(alloc_bmp, 0, cnt, false);
+     default:
+         return bitalloc_alloc(alloc_shards, cnt);
+     }
+ }
+ 
+ static void free_run(size_t idx, size_t cnt) {
+     switch (alloc_mode) {
+     case ALLOC_MUTEX:
+         pthread_mutex_lock(&alloc_lock);
+         bitmap_set_multiple(alloc_bmp, idx, cnt, false);
+         pthread_mutex_unlock(&alloc_lock);
+         break;
+     case ALLOC_LOCKFREE:
+         bitmap_set_multiple_atomic(alloc_bmp, idx, cnt, false, memory_order_release);
+         break;
+     default:
+         bitalloc_free(alloc_shards, idx, cnt);
+         break;
+     }
+ }
+ 
+ /*
+  * alloc_worker:
+  *   - 최대 ALLOC_HELD개의 할당을 보유하면서 가장 오래된 할당을 해제하고 새로 할당하기를 반복.
+  *   - 할당받은 비트에 자신의 번호를 기록하고, 해제 전에 다른 스레드가 덮어쓰지 않았는지 검사.
+  */
+ static void *alloc_worker(void *arg) {
+     int id = (int)(intptr_t)arg;
+     uint32_t seed = 2463534242u + id * 7919u;
+     size_t held_idx[ALLOC_HELD], held_cnt[ALLOC_HELD];
+     int ops = ALLOC_OPS / alloc_threads;
+ 
+     for (int h = 0; h < ALLOC_HELD; h++)
+         held_idx[h] = BITMAP_ERROR;
+     for (int op = 0; op < ops; op++) {
+         int h = op % ALLOC_HELD;
+         if (held_idx[h] != BITMAP_ERROR) {
+             for (size_t i = 0; i < held_cnt[h]; i++)
+                 if (alloc_owner[held_idx[h] + i] != id + 1)
+                     alloc_conflict = true;
+             free_run(held_idx[h], held_cnt[h]);
+         }
+         held_cnt[h] = 1 + next_random(&seed) % ALLOC_MAX_RUN;
+         held_idx[h] = alloc_run(held_cnt[h]);
+         if (held_idx[h] != BITMAP_ERROR)
+             for (size_t i = 0; i < held_cnt[h]; i++)
+                 alloc_owner[held_idx[h] + i] = id + 1;
+     }
+     return NULL;
+ }
+ 
+ /*
+  * bench_alloc:
+  *   - 1~32개의 스레드가 ALLOC_BITS 비트에서 할당/해제할 때의 처리량을 비교.
+  *   - 전역 뮤텍스 방식, lock-free 방식(bitmap_scan_and_flip_atomic),
+  *     스레드 수만큼 샤드를 둔 bitalloc 방식을 차례로 측정.
+  */
+ static void bench_alloc(void) {
+     printf("%-8s %-10s %14s %s\n", "threads", "mode", "ops/sec", "check");
+     for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+         for (int mode = 0; mode < ALLOC_MODE_COUNT; mode++) {
+             alloc_mode = mode;
+             alloc_threads = threads;
+             alloc_conflict = false;
+             alloc_bmp = bitmap_create(ALLOC_BITS);
+             alloc_shards = bitalloc_create(ALLOC_BITS, threads);
+             memset(alloc_owner, 0, sizeof(alloc_owner));
+             double elapsed = run_threads(threads, alloc_worker);
+             int total_ops = ALLOC_OPS / threads * threads;
+             printf("%-8d %-10s %14.0f %s\n", threads, alloc_mode_names[mode],
+                    total_ops / elapsed, alloc_conflict ? "CONFLICT" : "ok");
+             bitalloc_destroy(alloc_shards);
+             bitmap_destroy(alloc_bmp);
+         }
+     }
+ }
+ 
+ /* ---------------------- */
+ /*   SIMD 커널 벤치마크    */
+ /* ---------------------- */
+ 
+ /*
+  * bench_simd:
+  *   - SIMD_BITS 크기의 비트맵에 대해 count, set_multiple, contains, xor, and_count와
+  *     같은 크기의 버퍼에 대한 hash_bytes를 CPU가 지원하는 각 구현 수준으로 측정 (GB/s).
+  */
+ static void bench_simd(void) {
+     struct bitmap *a = bitmap_create(SIMD_BITS);
+     struct bitmap *b = bitmap_create(SIMD_BITS);
+     struct bitmap *dst = bitmap_create(SIMD_BITS);
+     enum simd_level saved = simd_level();
+     double bytes = SIMD_BITS / 8.0 * SIMD_REPEAT;
+     uint32_t seed = 2463534242u;
+     size_t sink = 0;
+     unsigned char *buf = malloc(SIMD_BITS / 8);
+ 
+     for (size_t i = 0; i < SIMD_BITS / 8; i++)
+         buf[i] = next_random(&seed);
+     for (size_t i = 0; i < SIMD_BITS / 4; i++) {
+         bitmap_mark(a, next_random(&seed) % SIMD_BITS);
+         bitmap_mark(b, next_random(&seed) % SIMD_BITS);
+     }
+ 
+     printf("%-8s %10s %10s %10s %10s %10s %10s\n", "level",
+            "count", "fill", "contains", "xor", "and_count", "hash");
+     for (int level = 0; level < SIMD_LEVEL_CNT; level++) {
+         if (!simd_select(level))
+             continue;
+         double t[6];
+         double start = now_sec();
+         for (int r = 0; r < SIMD_REPEAT; r++)
+             sink += bitmap_count(a, 0, SIMD_BITS, true);
+         t[0] = now_sec() - start;
+         start = now_sec();
+         for (int r = 0; r < SIMD_REPEAT; r++)
+             bitmap_set_multiple(dst, 0, SIMD_BITS, r & 1);
+         t[1] = now_sec() - start;
+         bitmap_set_all(dst, false);
+         start = now_sec();
+         for (int r = 0; r < SIMD_REPEAT; r++)
+             sink += bitmap_contains(dst, 0, SIMD_BITS, true);
+         t[2] = now_sec() - start;
+         start = now_sec();
+         for (int r = 0; r < SIMD_REPEAT; r++)
+             bitmap_xor(dst, a, b);
+         t[3] = now_sec() - start;
+         start = now_sec();
+         for (int r = 0; r < SIMD_REPEAT; r++)
+             sink += bitmap_and_count(a, b);
+         t[4] = now_sec() - start;
+         start = now_sec();
+         for (int r = 0; r < SIMD_REPEAT; r++)
+             sink += hash_bytes(buf, SIMD_BITS / 8);
+         t[5] = now_sec() - start;
+         printf("%-8s", simd_level_name(level));
+         for (int i = 0; i < 6; i++)
+             printf(" %10.2f", bytes / t[i] / 1e9);
+         printf("\n");
+     }
+     if (sink == 42)
+         printf("\n");    // 최적화로 측정 루프가 제거되지 않도록 결과를 사용
+     simd_select(saved);
+     free(buf);
+     bitmap_destroy(dst);
+     bitmap_destroy(b);
+     bitmap_destroy(a);
+ }
+ 
+ /* ---------------------- */
+ /*  rank/select 벤치마크   */
+ /* ---------------------- */
+ 
+ /*
+  * bench_rank:
+  *   - RANK_BITS 비트맵에서 rank와 select 질의 한 번에 걸리는 시간(ns)을 비교.
+  *   - rank 디렉터리 없이 처음부터 세는 방식과 bitmap_enable_rank를 사용한 방식을 측정.
+  *   - 비트를 하나 바꾼 뒤 첫 질의에서 디렉터리를 다시 계산하는 비용도 함께 측정.
+  */
+ static void bench_rank(void) {
+     struct bitmap *bmp = bitmap_create(RANK_BITS);
+     uint32_t seed = 2463534242u;
+     size_t sink = 0;
+ 
+     for (size_t i = 0; i < RANK_BITS / 8; i++)
+         bitmap_mark(bmp, next_random(&seed) % RANK_BITS);
+     size_t total = bitmap_count(bmp, 0, RANK_BITS, true);
+ 
+     printf("%-10s %12s %12s\n", "mode", "rank ns", "select ns");
+     for (int ranked = 0; ranked < 2; ranked++) {
+         int queries = ranked ? RANK_QUERIES : RANK_SCAN_QUERIES;
+         if (ranked) {
+             bitmap_enable_rank(bmp);
+             sink += bitmap_rank(bmp, RANK_BITS);    // 디렉터리를 미리 계산
+         }
+         double start = now_sec();
+         for (int q = 0; q < queries; q++)
+             sink += bitmap_rank(bmp, next_random(&seed) % RANK_BITS);
+         double rank_ns = (now_sec() - start) / queries * 1e9;
+         start = now_sec();
+         for (int q = 0; q < queries; q++)
+             sink += bitmap_select(bmp, next_random(&seed) % total);
+         double select_ns = (now_sec() - start) / queries * 1e9;
+         printf("%-10s %12.1f %12.1f\n", ranked ? "directory" : "scan", rank_ns, select_ns);
+     }
+ 
+     /* 앞쪽 비트를 바꾸면 다음 질의가 디렉터리 전체를 다시 계산함 */
+     double start = now_sec();
+     for (int q = 0; q < RANK_SCAN_QUERIES; q++) {
+         bitmap_flip(bmp, 0);
+         sink += bitmap_rank(bmp, RANK_BITS);
+     }
+     printf("%-10s %12.1f\n", "rebuild", (now_sec() - start) / RANK_SCAN_QUERIES * 1e9);
+     if (sink == 42)
+         printf("\n");    // 최적화로 측정 루프가 제거되지 않도록 결과를 사용
+     bitmap_destroy(bmp);
+ }
+ 
+ /* ---------------------- */
+ /*    버디 할당자 벤치마크  */
+ /* ---------------------- */
+ 
+ /*
+  * longest_clear_run:
+  *   - 비트맵에서 가장 긴 연속된 0 비트 구간의 길이를 반환.
+  */
+ static size_t longest_clear_run(const struct bitmap *bmp) {
+     size_t longest = 0;
+     size_t start = bitmap_next_clear(bmp, 0);
+     while (start != BITMAP_ERROR) {
+         size_t end = bitmap_next_set(bmp, start);
+         if (end == BITMAP_ERROR)
+             end = bitmap_size(bmp);
+         if (end - start > longest)
+             longest = end - start;
+         start = end < bitmap_size(bmp) ? bitmap_next_clear(bmp, end) : BITMAP_ERROR;
+     }
+     return longest;
+ }
+ 
+ /*
+  * bench_buddy:
+  *   - BUDDY_UNITS 범위에서 2의 거듭제곱 크기 블록을 BUDDY_HELD개 보유한 채
+  *     무작위로 해제/재할당을 반복하며 처리량과 단편화를 비교.
+  *   - first-fit(bitmap_scan_and_flip)과 버디 할당자(buddy_alloc)를 같은 요청 순서로 측정.
+  *   - fail은 할당 실패 비율, largest는 마지막에 한 번에 할당할 수 있는 가장 큰 크기.
+  */
+ static void bench_buddy(void) {
+     static size_t held_idx[BUDDY_HELD], held_cnt[BUDDY_HELD];
+ 
+     printf("%-10s %12s %8s %10s %10s\n", "allocator", "ops/sec", "fail", "free", "largest");
+     for (int use_buddy = 0; use_buddy < 2; use_buddy++) {
+         struct bitmap *bmp = use_buddy ? NULL : bitmap_create(BUDDY_UNITS);
+         struct buddy *allocator = use_buddy ? buddy_create(BUDDY_UNITS) : NULL;
+         uint32_t seed = 2463534242u;
+         int failures = 0;
+ 
+         for (int h = 0; h < BUDDY_HELD; h++)
+             held_idx[h] = BITMAP_ERROR;
+         double start = now_sec();
+         for (int op = 0; op < BUDDY_HELD + BUDDY_OPS; op++) {
+             int h = op < BUDDY_HELD ? op : (int)(next_random(&seed) % BUDDY_HELD);
+             if (held_idx[h] != BITMAP_ERROR) {
+                 if (use_buddy)
+                     buddy_free(allocator, held_idx[h]);
+                 else
+                     bitmap_set_multiple(bmp, held_idx[h], held_cnt[h], false);
+             }
+             held_cnt[h] = (size_t)1 << (next_random(&seed) % (BUDDY_MAX_ORDER + 1));
+             if (use_buddy)
+                 held_idx[h] = buddy_alloc(allocator, held_cnt[h]);
+             else
+                 held_idx[h] = bitmap_scan_and_flip(bmp, 0, held_cnt[h], false);
+             if (held_idx[h] == BITMAP_ERROR)
+                 failures++;
+         }
+         double elapsed = now_sec() - start;
+ 
+         size_t free_units = use_buddy ? buddy_available(allocator)
+                                       : bitmap_count(bmp, 0, BUDDY_UNITS, false);
+         size_t largest = use_buddy ? buddy_largest(allocator) : longest_clear_run(bmp);
+         printf("%-10s %12.0f %7.2f%% %10zu %10zu\n", use_buddy ? "buddy" : "first-fit",
+                (BUDDY_HELD + BUDDY_OPS) / elapsed,
+                100.0 * failures / (BUDDY_HELD + BUDDY_OPS), free_units, largest);
+         buddy_destroy(allocator);
+         bitmap_destroy(bmp);
+     }
+ }
+ 
+ /* ---------------------- */
+ /*  고정 크기 비트맵 벤치마크 */
+ /* ---------------------- */
+ 
+ BITMAP_DECLARE(fixed_bitmap, FIXED_BITS);
+ 
+ /*
+  * bench_fixed:
+  *   - FIXED_BITS 크기의 비트맵에서 flip, count, scan을 한 번씩 수행하는 연산의 처리량을 비교.
+  *   - 힙에 할당하는 struct bitmap과 BITMAP_DECLARE로 만든 스택 위의 비트맵을 같은 순서로 측정.
+  */
+ static void bench_fixed(void) {
+     printf("%-10s %12s\n", "bitmap", "ops/sec");
+     for (int fixed = 0; fixed < 2; fixed++) {
+         struct bitmap *bmp = fixed ? NULL : bitmap_create(FIXED_BITS);
+         struct fixed_bitmap fbmp;
+         uint32_t seed = 2463534242u;
+         size_t sink = 0;
+ 
+         fixed_bitmap_init(&fbmp);
+         double start = now_sec();
+         for (int op = 0; op < FIXED_OPS; op++) {
+             size_t idx = next_random(&seed) % FIXED_BITS;
+             if (fixed) {
+                 fixed_bitmap_flip(&fbmp, idx);
+                 sink += fixed_bitmap_count(&fbmp, 0, FIXED_BITS, true);
+                 sink += fixed_bitmap_scan(&fbmp, 0, 3, false);
+             } else {
+                 bitmap_flip(bmp, idx);
+                 sink += bitmap_count(bmp, 0, FIXED_BITS, true);
+                 sink += bitmap_scan(bmp, 0, 3, false);
+             }
+         }
+         double elapsed = now_sec() - start;
+         printf("%-10s %12.0f\n", fixed ? "fixed" : "dynamic", FIXED_OPS / elapsed);
+         if (sink == 42)
+             printf("\n");    // 최적화로 측정 루프가 제거되지 않도록 결과를 사용
+         bitmap_destroy(bmp);
+     }
+ }
+ 
+ /* ---------------------- */
+ /*    블룸 필터 벤치마크    */
+ /* ---------------------- */
+ 
+ /*
+  * bench_bloom:
+  *   - 키당 BLOOM_BITS_PER_KEY 비트인 블룸 필터에 BLOOM_KEYS개의 키를 넣고,
+  *     해시 수 k에 따른 삽입/질의 처리량과 거짓 양성 비율을 비교.
+  *   - 짝수 키를 삽입하고 삽입하지 않은 홀수 키로 질의하여 거짓 양성 비율을 측정.
+  *   - str fp는 같은 방식으로 "user:0000000" 형태의 연속된 문자열 키를 넣었을 때의 거짓 양성 비율.
+  *     끝 글자만 다른 키들이 같은 블록에 몰리지 않는지 확인하기 위한 것으로, fp와 비슷해야 함.
+  *   - expected는 블록으로 나누지 않은 필터의 이론값 (1 - e^(-k/비트 수))^k.
+  */
+ static void bench_bloom(void) {
+     static const int hash_counts[] = { 1, 2, 3, 4, 6, 7, 8, 10 };
+     char key[16];
+ 
+     printf("%-4s %14s %14s %10s %10s %10s\n", "k", "insert ops/s", "query ops/s", "fp", "str fp", "expected");
+     for (size_t h = 0; h < sizeof hash_counts / sizeof hash_counts[0]; h++) {
+         int k = hash_counts[h];
+         struct bloom *filter = bloom_create((size_t)BLOOM_KEYS * BLOOM_BITS_PER_KEY, k);
+         size_t positives = 0;
+ 
+         double start = now_sec();
+         for (int i = 0; i < BLOOM_KEYS; i++)
+             bloom_insert_int(filter, 2 * i);
+         double insert_time = now_sec() - start;
+         start = now_sec();
+         for (int i = 0; i < BLOOM_KEYS; i++)
+             positives += bloom_query_int(filter, 2 * i + 1);
+         double query_time = now_sec() - start;
+ 
+         size_t str_positives = 0;
+         bloom_clear(filter);
+         for (int i = 0; i < BLOOM_KEYS; i++) {
+             snprintf(key, sizeof key, "user:%07d", 2 * i);
+             bloom_insert(filter, key, strlen(key));
+         }
+         for (int i = 0; i < BLOOM_KEYS; i++) {
+             snprintf(key, sizeof key, "user:%07d", 2 * i + 1);
+             str_positives += bloom_query(filter, key, strlen(key));
+         }
+ 
+         double expected = pow(1 - exp(-(double)k / BLOOM_BITS_PER_KEY), k);
+         printf("%-4d %14.0f %14.0f %9.3f%% %9.3f%% %9.3f%%\n", k, BLOOM_KEYS / insert_time,
+                BLOOM_KEYS / query_time, 100.0 * positives / BLOOM_KEYS,
+                100.0 * str_positives / BLOOM_KEYS, 100.0 * expected);
+         bloom_destroy(filter);
+     }
+ }
+ 
+ /* ---------------------- */
+ /*      스냅샷 벤치마크     */
+ /* ---------------------- */
+ 
+ /*
+  * bench_snapshot:
+  *   - SNAPSHOT_BITS 비트맵의 시점 복사본을 만드는 시간(ms)을 전체 복사와 bitmap_snapshot으로 비교.
+  *   - 복사본을 만든 직후 SNAPSHOT_WRITES번의 무작위 쓰기 처리량도 측정.
+  *     스냅샷을 만든 경우 각 청크를 처음 수정할 때 복사하는 비용이 여기에 포함됨.
+  */
+ static void bench_snapshot(void) {
+     struct bitmap *bmp = bitmap_create(SNAPSHOT_BITS);
+     uint32_t seed = 2463534242u;
+ 
+     for (size_t i = 0; i < SNAPSHOT_BITS / 64; i++)
+         bitmap_mark(bmp, next_random(&seed) % SNAPSHOT_BITS);
+ 
+     printf("%-10s %12s %14s\n", "mode", "copy ms", "writes/sec");
+     for (int use_snapshot = 0; use_snapshot < 2; use_snapshot++) {
+         struct bitmap *copy = NULL;
+         struct bitmap_snapshot *snap = NULL;
+ 
+         double start = now_sec();
+         if (use_snapshot) {
+             snap = bitmap_snapshot(bmp);
+         } else {
+             copy = bitmap_create(SNAPSHOT_BITS);
+             bitmap_or(copy, bmp, bmp);    // A OR A는 A와 같으므로 전체 복사
+         }
+         double copy_ms = (now_sec() - start) * 1e3;
+ 
+         start = now_sec();
+         for (int w = 0; w < SNAPSHOT_WRITES; w++)
+             bitmap_flip(bmp, next_random(&seed) % SNAPSHOT_BITS);
+         double elapsed = now_sec() - start;
+         printf("%-10s %12.3f %14.0f\n", use_snapshot ? "snapshot" : "copy", copy_ms,
+                SNAPSHOT_WRITES / elapsed);
+         bitmap_snapshot_destroy(snap);
+         bitmap_destroy(copy);
+     }
+     bitmap_destroy(bmp);
+ }
+ 
+ /* ---------------------- */
+ /*    해시 테이블 벤치마크   */
+ /* ---------------------- */
+ 
+ /* 해시 테이블 벤치마크에 사용하는 요소 */
+ struct bench_node {
+     struct hash_elem elem;
+     int key;
+ };
+ 
+ /*
+  * bench_node_of:
+  *   - hash_elem 포인터로부터 이를 포함하는 bench_node를 반환.
+  */
+ static struct bench_node *bench_node_of(const struct hash_elem *e) {
+     return (struct bench_node *)((char *)e - offsetof(struct bench_node, elem));
+ }
+ 
+ static unsigned bench_node_hash(const struct hash_elem *e, void *aux) {
+     (void)aux;
+     return hash_int(bench_node_of(e)->key);
+ }
+ 
+ static bool bench_node_less(const struct hash_elem *a, const struct hash_elem *b, void *aux) {
+     (void)aux;
+     return bench_node_of(a)->key < bench_node_of(b)->key;
+ }
+ 
+ /*
+  * bench_hash:
+  *   - 체이닝 테이블(HASH_CHAINED)과 개방 주소법 테이블(HASH_OPEN)의 조회 시간(ns)을 비교.
+  *   - HASH_SLOTS의 45%~85%에 해당하는 수의 짝수 키를 넣고, 있는 키(hit)와 없는 홀수 키(miss)로 조회.
+  *   - load는 요소 수를 버킷(체이닝) 또는 슬롯(개방 주소법) 수로 나눈 실제 부하율.
+  */
+ static void bench_hash(void) {
+     static const double fills[] = { 0.45, 0.60, 0.75, 0.85 };
+     static const char *engine_names[] = { "chained", "open" };
+ 
+     printf("%-8s %-8s %8s %10s %10s\n", "elems", "engine", "load", "hit ns", "miss ns");
+     for (size_t f = 0; f < sizeof fills / sizeof fills[0]; f++) {
+         int count = (int)(HASH_SLOTS * fills[f]);
+         struct bench_node *nodes = malloc(sizeof *nodes * count);
+ 
+         for (int engine = HASH_CHAINED; engine <= HASH_OPEN; engine++) {
+             struct hash table;
+             struct bench_node probe;
+             uint32_t seed = 2463534242u;
+             size_t sink = 0;
+ 
+             hash_init_engine(&table, engine, bench_node_hash, bench_node_less, NULL);
+             for (int i = 0; i < count; i++) {
+                 nodes[i].key = 2 * i;
+                 hash_insert(&table, &nodes[i].elem);
+             }
+ 
+             double ns[2];
+             for (int miss = 0; miss < 2; miss++) {
+                 double start = now_sec();
+                 for (int q = 0; q < HASH_QUERIES; q++) {
+                     probe.key = 2 * (int)(next_random(&seed) % count) + miss;
+                     sink += hash_find(&table, &probe.elem) != NULL;
+                 }
+                 ns[miss] = (now_sec() - start) / HASH_QUERIES * 1e9;
+             }
+             printf("%-8d %-8s %8.2f %10.1f %10.1f\n", count, engine_names[engine],
+                    (double)hash_size(&table) / table.bucket_cnt, ns[0], ns[1]);
+             if (sink == 42)
+                 printf("\n");    // 최적화로 측정 루프가 제거되지 않도록 결과를 사용
+             hash_destroy(&table, NULL);
+         }
+         free(nodes);
+     }
+ }
+ 
+ /*
+  * bench_rehash:
+  *   - 빈 테이블에 REHASH_KEYS개의 키를 하나씩 삽입하면서 삽입마다 걸린 시간을 측정.
+  *   - 재해싱이 점진적으로 이루어지므로 평균보다 최대 지연 시간과 느린 삽입의 수가 중요.
+  *   - reserved 행은 hash_reserve()로 미리 크기를 잡아 둔 경우로, 삽입 도중 재해싱이 일어나지 않음.
+  *   - 측정값에는 시계를 읽는 시간(수십 ns)이 포함됨.
+  */
+ static void bench_rehash(void) {
+     static const char *engine_names[] = { "chained", "open" };
+     struct bench_node *nodes = malloc(sizeof *nodes * REHASH_KEYS);
+ 
+     printf("%-8s %-9s %10s %10s %10s\n", "engine", "sizing", "avg ns", "max us", "slow");
+     for (int run = 0; run < 4; run++) {
+         int engine = run / 2 ? HASH_OPEN : HASH_CHAINED;
+         bool reserved = run % 2;
+         struct hash table;
+         double total = 0, worst = 0;
+         size_t slow = 0;
+ 
+         hash_init_engine(&table, engine, bench_node_hash, bench_node_less, NULL);
+         if (reserved)
+             hash_reserve(&table, REHASH_KEYS);
+         for (int i = 0; i < REHASH_KEYS; i++) {
+             nodes[i].key = i;
+             double start = now_sec();
+             hash_insert(&table, &nodes[i].elem);
+             double ns = (now_sec() - start) * 1e9;
+ 
+             total += ns;
+             if (ns > worst)
+                 worst = ns;
+             if (ns > REHASH_SLOW_NS)
+                 slow++;
+         }
+         printf("%-8s %-9s %10.1f %10.1f %10zu\n", engine_names[engine],
+                reserved ? "reserved" : "grow", total / REHASH_KEYS, worst / 1e3, slow);
+         hash_destroy(&table, NULL);
+     }
+     free(nodes);
+ }
+ 
+ /* 문자열 키를 가진 해시 테이블 요소 (해시 값을 캐시하는 테이블에도 넣으므로 hash_cached_elem을 포함) */
+ struct str_node {
+     struct hash_cached_elem elem;
+     char key[STRHASH_LEN + 1];
+ };
+ 
+ static size_t str_less_calls;    // 비교 함수 호출 횟수
+ 
+ static struct str_node *str_node_of(const struct hash_elem *e) {
+     return (struct str_node *)((char *)e - offsetof(struct str_node, elem.elem));
+ }
+ 
+ static unsigned str_node_hash(const struct hash_elem *e, void *aux) {
+     (void)aux;
+     return hash_string(str_node_of(e)->key);
+ }
+ 
+ static bool str_node_less(const struct hash_elem *a, const struct hash_elem *b, void *aux) {
+     (void)aux;
+     str_less_calls++;
+     return strcmp(str_node_of(a)->key, str_node_of(b)->key) < 0;
+ }
+ 
+ /*
+  * bench_strhash:
+  *   - 길이 STRHASH_LEN의 문자열 키로 해시 값 캐시(hash_cache_hashes)의 효과를 측정.
+  *   - insert는 크기 조정을 포함한 전체 삽입 시간, miss는 없는 키 조회 시간과 조회당 비교 함수 호출 수.
+  */
+ static void bench_strhash(void) {
+     static const char *engine_names[] = { "chained", "open" };
+     struct str_node *nodes = malloc(sizeof *nodes * STRHASH_KEYS);
+     struct str_node *probes = malloc(sizeof *probes * STRHASH_KEYS);    // 없는 키
+ 
+     for (int i = 0; i < STRHASH_KEYS; i++) {
+         snprintf(nodes[i].key, sizeof nodes[i].key, "%0*d", STRHASH_LEN, i);
+         snprintf(probes[i].key, sizeof probes[i].key, "x%0*d", STRHASH_LEN - 1, i);
+     }
+ 
+     printf("%-8s %-6s %10s %10s %12s\n", "engine", "cache", "insert ms", "miss ns", "less/miss");
+     for (int run = 0; run < 4; run++) {
+         int engine = run / 2 ? HASH_OPEN : HASH_CHAINED;
+         bool cache = run % 2;
+         struct hash table;
+         size_t sink = 0;
+ 
+         hash_init_engine(&table, engine, str_node_hash, str_node_less, NULL);
+         hash_cache_hashes(&table, cache);
+         double start = now_sec();
+         for (int i = 0; i < STRHASH_KEYS; i++)
+             hash_insert(&table, &nodes[i].elem.elem);
+         double insert_ms = (now_sec() - start) * 1e3;
+ 
+         str_less_calls = 0;
+         start = now_sec();
+         for (int i = 0; i < STRHASH_KEYS; i++)
+             sink += hash_find(&table, &probes[i].elem.elem) != NULL;
+         double miss_ns = (now_sec() - start) / STRHASH_KEYS * 1e9;
+ 
+         printf("%-8s %-6s %10.1f %10.1f %12.2f\n", engine_names[engine], cache ? "on" : "off",
+                insert_ms, miss_ns, (double)str_less_calls / STRHASH_KEYS);
+         if (sink == 42)
+             printf("\n");    // 최적화로 측정 루프가 제거되지 않도록 결과를 사용
+         hash_destroy(&table, NULL);
+     }
+     free(nodes);
+     free(probes);
+ }
+ 
+ /* 빈도 세기 벤치마크에 사용하는 요소 */
+ struct count_node {
+     struct hash_elem elem;
+     int key;
+     int count;
+ };
+ 
+ static struct count_node *count_node_of(const struct hash_elem *e) {
+     return (struct count_node *)((char *)e - offsetof(struct count_node, elem));
+ }
+ 
+ static unsigned count_node_hash(const struct hash_elem *e, void *aux) {
+     (void)aux;
+     return hash_int(count_node_of(e)->key);
+ }
+ 
+ static bool count_node_less(const struct hash_elem *a, const struct hash_elem *b, void *aux) {
+     (void)aux;
+     return count_node_of(a)->key < count_node_of(b)->key;
+ }
+ 
+ static bool count_node_eq(const struct hash_elem *a, const struct hash_elem *b, void *aux) {
+     (void)aux;
+     return count_node_of(a)->key == count_node_of(b)->key;
+ }
+ 
+ static void count_node_bump(struct hash_elem *e, void *aux) {
+     (void)aux;
+     count_node_of(e)->count++;
+ }
+ 
+ /*
+  * bench_count:
+  *   - COUNT_KEYS개의 키 중에서 무작위로 뽑은 COUNT_OPS개 키의 빈도를 빈 테이블에서 세는 시간(ns/키)을 측정.
+  *   - 새 키의 비율이 높아야 탐색을 한 번으로 줄인 효과가 드러나므로 키 수의 두 배만큼만 셈.
+  *   - find+insert: hash_find()로 찾고 없으면 hash_insert() (해싱과 탐색을 두 번 수행).
+  *   - find_or_insert: hash_find_or_insert() 한 번으로 처리.
+  *   - upsert+eq: hash_set_eq()로 동등 비교 함수를 지정하고 hash_upsert()로 처리.
+  *   - 새 키가 나올 때만 다음 요소를 사용하도록 미리 할당한 요소 배열을 순서대로 사용.
+  */
+ static void bench_count(void) {
+     static const char *engine_names[] = { "chained", "open" };
+     static const char *mode_names[] = { "find+insert", "find_or_insert", "upsert+eq" };
+     struct count_node *nodes = malloc(sizeof *nodes * COUNT_KEYS);
+ 
+     printf("%-8s %-15s %10s\n", "engine", "mode", "ns/key");
+     for (int engine = HASH_CHAINED; engine <= HASH_OPEN; engine++) {
+         for (int mode = 0; mode < 3; mode++) {
+             uint32_t seed = 2463534242u;
+             double elapsed = 0;
+             bool ok = true;
+ 
+             for (int round = 0; round < COUNT_ROUNDS; round++) {
+                 struct hash table;
+                 size_t used = 0;
+                 long total = 0;
+ 
+                 hash_init_engine(&table, engine, count_node_hash, count_node_less, NULL);
+                 if (mode == 2)
+                     hash_set_eq(&table, count_node_eq);
+                 double start = now_sec();
+                 for (int i = 0; i < COUNT_OPS; i++) {
+                     struct count_node *spare = &nodes[used];
+                     struct hash_elem *e;
+ 
+                     spare->key = (int)(next_random(&seed) % COUNT_KEYS);
+                     spare->count = 1;
+                     if (mode == 0) {
+                         e = hash_find(&table, &spare->elem);
+                         if (e != NULL)
+                             count_node_of(e)->count++;
+                         else
+                             hash_insert(&table, &spare->elem);
+                     } else if (mode == 1) {
+                         e = hash_find_or_insert(&table, &spare->elem);
+                         if (e != &spare->elem)
+                             count_node_of(e)->count++;
+                     } else
+                         e = hash_upsert(&table, &spare->elem, count_node_bump);
+                     if (e == NULL || e == &spare->elem)
+                         used++;
+                 }
+                 elapsed += now_sec() - start;
+ 
+                 for (size_t i = 0; i < used; i++)
+                     total += nodes[i].count;
+                 ok = ok && total == COUNT_OPS;
+                 hash_destroy(&table, NULL);
+             }
+             printf("%-8s %-15s %10.1f%s\n", engine_names[engine], mode_names[mode],
+                    elapsed / COUNT_ROUNDS / COUNT_OPS * 1e9, ok ? "" : "  (count mismatch)");
+         }
+     }
+     free(nodes);
+ }
+ 
+ /* 해시 값을 캐시하는 체이닝 테이블에 넣는 요소 (hash_cached_elem 포함) */
+ struct cached_node {
+     struct hash_cached_elem elem;
+     int key;
+ };
+ 
+ static struct cached_node *cached_node_of(const struct hash_elem *e) {
+     return (struct cached_node *)((char *)e - offsetof(struct cached_node, elem.elem));
+ }
+ 
+ static unsigned cached_node_hash(const struct hash_elem *e, void *aux) {
+     (void)aux;
+     return hash_int(cached_node_of(e)->key);
+ }
+ 
+ static bool cached_node_less(const struct hash_elem *a, const struct hash_elem *b, void *aux) {
+     (void)aux;
+     return cached_node_of(a)->key < cached_node_of(b)->key;
+ }
+ 
+ /*
+  * bench_hashmem:
+  *   - 세 엔진에 정수 키를 넣었을 때의 메모리 사용량과 조회 시간을 비교.
+  *   - chained+c는 해시 값을 캐시하는 체이닝 테이블로, 요소마다 hash_cached_elem이 필요함.
+  *     compact는 연결 필드에 해시 값을 함께 저장하므로 같은 캐시를 hash_elem 크기로 얻음.
+  *   - table B/elem: 버킷(또는 슬롯) 배열의 바이트 수를 요소 수로 나눈 값.
+  *   - elem B: 각 요소에 포함해야 하는 연결 구조체의 크기.
+  *   - total B/elem: 위 두 값의 합.
+  */
+ static void bench_hashmem(void) {
+     static const int sizes[] = { 1 << 10, 1 << 16, 1 << 20 };
+     static const struct {
+         const char *name;
+         int engine;
+         bool cache;
+     } configs[] = {
+         { "chained", HASH_CHAINED, false },
+         { "chained+c", HASH_CHAINED, true },
+         { "open", HASH_OPEN, false },
+         { "compact", HASH_COMPACT, true },
+     };
+ 
+     printf("%-8s %-10s %12s %7s %12s %10s\n", "elems", "engine", "table B/elem", "elem B",
+            "total B/elem", "hit ns");
+     for (size_t n = 0; n < sizeof sizes / sizeof sizes[0]; n++) {
+         int count = sizes[n];
+         struct bench_node *nodes = malloc(sizeof *nodes * count);
+         struct cached_node *cached_nodes = malloc(sizeof *cached_nodes * count);
+ 
+         for (size_t c = 0; c < sizeof configs / sizeof configs[0]; c++) {
+             int engine = configs[c].engine;
+             bool cached = engine == HASH_CHAINED && configs[c].cache;
+             struct hash table;
+             struct bench_node probe;
+             struct cached_node cached_probe;
+             uint32_t seed = 2463534242u;
+             size_t sink = 0, per_bucket, elem_size;
+ 
+             if (cached) {
+                 hash_init_engine(&table, engine, cached_node_hash, cached_node_less, NULL);
+                 hash_cache_hashes(&table, true);
+                 elem_size = sizeof(struct hash_cached_elem);
+             }
+             else {
+                 hash_init_engine(&table, engine, bench_node_hash, bench_node_less, NULL);
+                 elem_size = sizeof(struct hash_elem);
+             }
+             for (int i = 0; i < count; i++) {
+                 nodes[i].key = cached_nodes[i].key = i;
+                 hash_insert(&table, cached ? &cached_nodes[i].elem.elem : &nodes[i].elem);
+             }
+             if (engine == HASH_CHAINED)
+                 per_bucket = sizeof(struct list);
+             else if (engine == HASH_OPEN)
+                 per_bucket = sizeof(struct hash_elem *) + 1;    // 슬롯 포인터 + 제어 바이트
+             else
+                 per_bucket = sizeof(struct hash_elem *);
+             double table_bytes = (double)table.bucket_cnt * per_bucket / count;
+ 
+             double start = now_sec();
+             for (int q = 0; q < HASHMEM_QUERIES; q++) {
+                 probe.key = cached_probe.key = (int)(next_random(&seed) % count);
+                 sink += hash_find(&table, cached ? &cached_probe.elem.elem : &probe.elem) != NULL;
+             }
+             double ns = (now_sec() - start) / HASHMEM_QUERIES * 1e9;
+ 
+             printf("%-8d %-10s %12.1f %7zu %12.1f %10.1f\n", count, configs[c].name,
+                    table_bytes, elem_size, table_bytes + elem_size, ns);
+             if (sink == 42)
+                 printf("\n");    // 최적화로 측정 루프가 제거되지 않도록 결과를 사용
+             hash_destroy(&table, NULL);
+         }
+         free(nodes);
+         free(cached_nodes);
+     }
+ }
+ 
+  static unsigned fnv_bytes(const void *buf, size_t size, uint64_t seed) {
+     (void)seed;
+     return hash_bytes(buf, size);
+ }
+ 
+ /* 키 값을 그대로 해시 값으로 사용하는 약한 해시 함수 */
+ static unsigned identity_hash(const struct hash_elem *e, void *aux) {
+     (void)aux;
+     return (unsigned)bench_node_of(e)->key;
+ }
+ 
+ /*
+  * bench_hashfn:
+  *   - 바이트열 해시 함수의 길이별 처리 속도(GB/s)와 정수 해시 함수의 호출당 시간(ns)을 비교.
+  *   - crc32c는 현재 SIMD 수준(AVX2 이상이면 CRC32 명령어)을 사용.
+  *   - 마지막으로 4096의 배수인 키를 키 값 그대로 해싱하는 테이블에 SEED_KEYS개를 넣는 시간을
+  *     시드 없이(모두 같은 버킷) 그리고 hash_set_seed()로 시드를 준 경우로 비교.
+  */
+ static void bench_hashfn(void) {
+     static const size_t lengths[] = { 8, 16, 64, 256, 4096 };
+     static const struct {
+         const char *name;
+         unsigned (*func)(const void *, size_t, uint64_t);
+     } funcs[] = {
+         { "fnv", fnv_bytes },
+         { "seed", hash_bytes_seed },
+         { "crc32c", hash_crc32c },
+     };
+     size_t func_count = sizeof funcs / sizeof funcs[0];
+     unsigned char *buf = malloc(4096 + 8);    // 시작 위치를 0~7바이트 어긋나게 하기 위한 여유 공간
+     unsigned sink = 0;
+ 
+     for (int i = 0; i < 4096 + 8; i++)
+         buf[i] = (unsigned char)(i * 131);
+ 
+     printf("%-8s", "bytes");
+     for (size_t f = 0; f < func_count; f++)
+         printf(" %10s", funcs[f].name);
+     printf("   (GB/s)\n");
+     for (size_t l = 0; l < sizeof lengths / sizeof lengths[0]; l++) {
+         size_t reps = HASHFN_BYTES / lengths[l];
+ 
+         printf("%-8zu", lengths[l]);
+         for (size_t f = 0; f < func_count; f++) {
+             double start = now_sec();
+             for (size_t r = 0; r < reps; r++)
+                 sink += funcs[f].func(buf + (r & 7), lengths[l], r);
+             printf(" %10.2f", (double)reps * lengths[l] / (now_sec() - start) / 1e9);
+         }
+         printf("\n");
+     }
+ 
+     double start = now_sec();
+     for (int i = 0; i < HASHFN_BYTES / 4; i++)
+         sink += hash_int_fnv(i);
+     double fnv_ns = (now_sec() - start) / (HASHFN_BYTES / 4) * 1e9;
+     start = now_sec();
+     for (int i = 0; i < HASHFN_BYTES / 4; i++)
+         sink += hash_int(i);
+     printf("hash_int_fnv %.2f ns, hash_int %.2f ns\n", fnv_ns,
+            (now_sec() - start) / (HASHFN_BYTES / 4) * 1e9);
+ 
+     struct bench_node *nodes = malloc(sizeof *nodes * SEED_KEYS);
+     for (int seeded = 0; seeded < 2; seeded++) {
+         struct hash table;
+ 
+         hash_init(&table, identity_hash, bench_node_less, NULL);
+         if (seeded)
+             hash_set_seed(&table, 0x9e3779b97f4a7c15ull);
+         start = now_sec();
+         for (int i = 0; i < SEED_KEYS; i++) {
+             nodes[i].key = i * 4096;
+             hash_insert(&table, &nodes[i].elem);
+         }
+         printf("identity hash, %s: %.1f ms to insert %d keys\n", seeded ? "seeded" : "no seed",
+                (now_sec() - start) * 1e3, SEED_KEYS);
+         hash_destroy(&table, NULL);
+     }
+     if (sink == 42)
+         printf("\n");    // 최적화로 측정 루프가 제거되지 않도록 결과를 사용
+     free(nodes);
+     free(buf);
+ }
+ 
+ /* 곱셈 해시 (main.c의 alternate_hash_int와 같은 함수) */
+ static unsigned mult_hash_int(int num) {
+     unsigned u = (unsigned)num;
+     return (u * 2654435761u) ^ (u >> 16);
+ }
+ 
+ static unsigned crc_hash_int(int num) {
+     return hash_crc32c(&num, sizeof num, 0);
+ }
+ 
+/* aux로 받은 정수 해시 함수로 키를 해싱 */
+ static unsigned dist_node_hash(const struct hash_elem *e, void *aux) {
+     unsigned (*func)(int) = *(unsigned (**)(int))aux;
+     return func(bench_node_of(e)->key);
+ }
+ 
+ /*
+  * bench_hashdist:
+  *   - 인터프리터에서 "create hashtable <이름> <함수>"로 고를 수 있는 정수 해시 함수들을
+  *     연속(seq), 1024 간격(stride), 무작위(random) 키 집합으로 비교.
+  *   - hash ns는 키 하나를 해싱하는 시간, find ns는 체이닝 테이블에서 있는 키를 조회하는 시간.
+  *   - empty, max, probe는 hash_get_stats()의 빈 버킷 비율, 최대 체인 길이, 평균 비교 횟수.
+  */
+ static void bench_hashdist(void) {
+     static const char *set_names[] = { "seq", "stride", "random" };
+     static const struct {
+         const char *name;
+         unsigned (*func)(int);
+     } funcs[] = {
+         { "mix", hash_int },
+         { "fnv", hash_int_fnv },
+         { "mult", mult_hash_int },
+         { "crc", crc_hash_int },
+     };
+     struct bench_node *nodes = malloc(sizeof *nodes * DIST_KEYS);
+     unsigned sink = 0;
+ 
+     printf("%-8s %-6s %8s %8s %8s %6s %8s\n", "keys", "func", "hash ns", "find ns", "empty", "max", "probe");
+     for (int set = 0; set < 3; set++) {
+         uint32_t seed = 2463534242u;
+ 
+         for (int i = 0; i < DIST_KEYS; i++)
+             nodes[i].key = set == 0 ? i : set == 1 ? i * 1024 : (int)next_random(&seed);
+         for (size_t f = 0; f < sizeof funcs / sizeof funcs[0]; f++) {
+             unsigned (*func)(int) = funcs[f].func;
+             struct hash table;
+             struct hash_stats stats;
+ 
+             double start = now_sec();
+             for (int r = 0; r < DIST_REPEAT; r++)
+                 for (int i = 0; i < DIST_KEYS; i++)
+                     sink += func(nodes[i].key + r);
+             double hash_ns = (now_sec() - start) / ((double)DIST_REPEAT * DIST_KEYS) * 1e9;
+ 
+             hash_init(&table, dist_node_hash, bench_node_less, &func);
+             for (int i = 0; i < DIST_KEYS; i++)
+                 hash_insert(&table, &nodes[i].elem);
+             hash_get_stats(&table, &stats);
+ 
+             start = now_sec();
+             for (int q = 0; q < DIST_QUERIES; q++)
+                 sink += hash_find(&table, &nodes[next_random(&seed) % DIST_KEYS].elem) != NULL;
+             double find_ns = (now_sec() - start) / DIST_QUERIES * 1e9;
+ 
+             printf("%-8s %-6s %8.2f %8.1f %8.3f %6zu %8.3f\n", set_names[set], funcs[f].name,
+                    hash_ns, find_ns, (double)stats.empty_cnt / stats.bucket_cnt,
+                    stats.max_len, stats.avg_probe);
+             hash_destroy(&table, NULL);
+         }
+     }
+     if (sink == 42)
+         printf("\n");    // 최적화로 측정 루프가 제거되지 않도록 결과를 사용
+     free(nodes);
+ }
+ 
+ /* ---------------------- */
+ /*          main         */
+ /* ---------------------- */
+ 
+ /* 벤치마크 목록 */
+ static const struct {
+     const char *name;
+     void (*func)(void);
+ } benchmarks[] = {
+     { "alloc", bench_alloc },
+     { "simd", bench_simd },
+     { "rank", bench_rank },
+     { "buddy", bench_buddy },
+     { "fixed", bench_fixed },
+     { "bloom", bench_bloom },
+     { "snapshot", bench_snapshot },
+     { "hash", bench_hash },
+     { "rehash", bench_rehash },
+     { "strhash", bench_strhash },
+     { "count", bench_count },
+     { "hashmem", bench_hashmem },
+     { "hashfn", bench_hashfn },
+     { "hashdist", bench_hashdist },
+ };
+ 
+ /*
+  * main:
+  *   - 인자로 주어진 이름의 벤치마크를 실행. 인자가 없으면 모든 벤치마크를 실행.
+  */
+ int main(int argc, char *argv[]) {
+     size_t bench_count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+     for (size_t i = 0; i < bench_count; i++) {
+         if (argc >= 2 && strcmp(argv[1], benchmarks[i].name) != 0)
+             continue;
+         printf("== %s ==\n", benchmarks[i].name);
+         benchmarks[i].func();
+     }
+     return 0;
+ }
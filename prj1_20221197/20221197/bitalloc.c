@@ -0,0 +1,219 @@
+/* Sharded bitmap allocator.
+
+   See bitalloc.h for basic information. */
+
+#include "bitalloc.h"
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "bitmap.h"
+#include "round.h"
+
+#define ASSERT(CONDITION) assert(CONDITION)
+
+/* Size of a cache line, in bytes.  Each shard's bookkeeping gets
+   a line of its own so that threads working in different shards
+   do not contend for it. */
+#define CACHE_LINE 64
+
+/* One shard of an allocator. */
+struct shard
+  {
+    struct bitmap *free_map;    /* Allocated bits are true. */
+    size_t base;                /* Index of the shard's first bit. */
+    size_t bit_cnt;             /* Number of bits in the shard. */
+    atomic_size_t free_cnt;     /* Number of free bits. */
+    atomic_size_t hint;         /* Where to start the next search. */
+  } __attribute__ ((aligned (CACHE_LINE)));
+
+/* Sharded allocator. */
+struct bitalloc
+  {
+    size_t bit_cnt;             /* Number of bits in all shards. */
+    size_t shard_cnt;           /* Number of shards. */
+    size_t shard_bits;          /* Bits per shard, except the last. */
+    struct shard *shards;       /* Array of `shard_cnt' shards. */
+  };
+
+/* Source of thread numbers, and the calling thread's number or
+   SIZE_MAX if it does not have one yet.  A thread's home shard
+   is its number modulo the shard count, so threads are spread
+   over the shards round-robin in the order they first
+   allocate. */
+static atomic_size_t next_thread_no;
+static _Thread_local size_t thread_no = SIZE_MAX;
+
+/* Creates and returns an allocator for BIT_CNT bits, all of
+   them free, divided into SHARD_CNT shards of nearly equal size.
+   Returns a null pointer if memory allocation failed. */
+struct bitalloc *
+bitalloc_create (size_t bit_cnt, size_t shard_cnt)
+{
+  struct bitalloc *a;
+  size_t i;
+
+  ASSERT (shard_cnt > 0);
+
+  a = malloc (sizeof *a);
+  if (a == NULL)
+    return NULL;
+  a->bit_cnt = bit_cnt;
+  a->shard_cnt = shard_cnt;
+  a->shard_bits = DIV_ROUND_UP (bit_cnt, shard_cnt);
+  a->shards = aligned_alloc (CACHE_LINE, sizeof *a->shards * shard_cnt);
+  if (a->shards == NULL)
+    {
+      free (a);
+      return NULL;
+    }
+
+  for (i = 0; i < shard_cnt; i++)
+    {
+      struct shard *s = &a->shards[i];
+      size_t base = i * a->shard_bits;
+
+      s->base = base < bit_cnt ? base : bit_cnt;
+      s->bit_cnt = bit_cnt - s->base < a->shard_bits
+                   ? bit_cnt - s->base : a->shard_bits;
+      s->free_map = bitmap_create (s->bit_cnt);
+      atomic_init (&s->free_cnt, s->bit_cnt);
+      atomic_init (&s->hint, 0);
+      if (s->free_map == NULL)
+        {
+          a->shard_cnt = i;
+          bitalloc_destroy (a);
+          return NULL;
+        }
+    }
+  return a;
+}
+
+/* Destroys allocator A.  Runs still allocated from it become
+   meaningless. */
+void
+bitalloc_destroy (struct bitalloc *a)
+{
+  if (a != NULL)
+    {
+      size_t i;
+
+      for (i = 0; i < a->shard_cnt; i++)
+        bitmap_destroy (a->shards[i].free_map);
+      free (a->shards);
+      free (a);
+    }
+}
+
+/* Tries to allocate CNT consecutive bits from shard S.  Searches
+   from the shard's hint to its end, then from its beginning, so
+   that successive allocations do not rescan the allocated front
+   of the shard.  Returns the index of the first bit within the
+   shard, or BITMAP_ERROR if the shard has no such run free. */
+static size_t
+shard_alloc (struct shard *s, size_t cnt)
+{
+  size_t hint, idx;
+
+  if (atomic_load_explicit (&s->free_cnt, memory_order_relaxed) < cnt)
+    return BITMAP_ERROR;
+
+  hint = atomic_load_explicit (&s->hint, memory_order_relaxed);
+  if (hint > s->bit_cnt)
+    hint = 0;
+  idx = bitmap_scan_and_flip_atomic (s->free_map, hint, cnt, false);
+  if (idx == BITMAP_ERROR && hint > 0)
+    idx = bitmap_scan_and_flip_atomic (s->free_map, 0, cnt, false);
+  if (idx == BITMAP_ERROR)
+    return BITMAP_ERROR;
+
+  atomic_fetch_sub_explicit (&s->free_cnt, cnt, memory_order_relaxed);
+  atomic_store_explicit (&s->hint, idx + cnt, memory_order_relaxed);
+  return idx;
+}
+
+/* Allocates CNT consecutive bits from A and returns the index of
+   the first one, trying the calling thread's home shard first
+   and then stealing from the others.  Returns BITMAP_ERROR if no
+   shard has CNT consecutive free bits. */
+size_t
+bitalloc_alloc (struct bitalloc *a, size_t cnt)
+{
+  return bitalloc_alloc_from (a, bitalloc_home (a), cnt);
+}
+
+/* Like bitalloc_alloc(), but uses shard HOME as the home shard
+   instead of the calling thread's. */
+size_t
+bitalloc_alloc_from (struct bitalloc *a, size_t home, size_t cnt)
+{
+  size_t i;
+
+  ASSERT (a != NULL);
+  ASSERT (home < a->shard_cnt);
+  ASSERT (cnt > 0);
+
+  for (i = 0; i < a->shard_cnt; i++)
+    {
+      struct shard *s = &a->shards[(home + i) % a->shard_cnt];
+      size_t idx = shard_alloc (s, cnt);
+      if (idx != BITMAP_ERROR)
+        return s->base + idx;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Frees the CNT bits starting at IDX in A, which must have been
+   allocated together by bitalloc_alloc() or
+   bitalloc_alloc_from(). */
+void
+bitalloc_free (struct bitalloc *a, size_t idx, size_t cnt)
+{
+  struct shard *s;
+
+  ASSERT (a != NULL);
+  ASSERT (idx < a->bit_cnt);
+
+  s = &a->shards[idx / a->shard_bits];
+  ASSERT (idx - s->base + cnt <= s->bit_cnt);
+  bitmap_set_multiple_atomic (s->free_map, idx - s->base, cnt, false,
+                              memory_order_release);
+  atomic_fetch_add_explicit (&s->free_cnt, cnt, memory_order_relaxed);
+}
+
+/* Returns the number of bits managed by A. */
+size_t
+bitalloc_size (const struct bitalloc *a)
+{
+  return a->bit_cnt;
+}
+
+/* Returns the number of shards in A. */
+size_t
+bitalloc_shard_cnt (const struct bitalloc *a)
+{
+  return a->shard_cnt;
+}
+
+/* Returns the calling thread's home shard in A. */
+size_t
+bitalloc_home (const struct bitalloc *a)
+{
+  if (thread_no == SIZE_MAX)
+    thread_no = atomic_fetch_add_explicit (&next_thread_no, 1,
+                                           memory_order_relaxed);
+  return thread_no % a->shard_cnt;
+}
+
+/* Returns the number of free bits in A.  Other threads may change
+   the count at any time, so the result is only a snapshot. */
+size_t
+bitalloc_available (const struct bitalloc *a)
+{
+  size_t i, cnt = 0;
+
+  for (i = 0; i < a->shard_cnt; i++)
+    cnt += atomic_load_explicit (&a->shards[i].free_cnt,
+                                 memory_order_relaxed);
+  return cnt;
+}
@@ -0,0 +1,38 @@
+#ifndef __MYLIB_BITALLOC_H
+#define __MYLIB_BITALLOC_H
+
+/* Sharded bitmap allocator.
+
+   Hands out runs of consecutive bit indexes from a fixed range,
+   like bitmap_scan_and_flip() on a bitmap of free bits, but
+   scales to many threads.  The range is divided into shards,
+   each with its own bitmap.  A thread allocates from its home
+   shard first and steals from the other shards only when its
+   home shard cannot satisfy the request, so threads rarely
+   touch each other's cache lines.  A run is always freed back
+   into the shard it came from.
+
+   A run never spans shards, so the largest run that can be
+   allocated is the size of a shard.  All functions except
+   bitalloc_create() and bitalloc_destroy() may be called from
+   any number of threads at once. */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Creation and destruction. */
+struct bitalloc *bitalloc_create (size_t bit_cnt, size_t shard_cnt);
+void bitalloc_destroy (struct bitalloc *);
+
+/* Allocation. */
+size_t bitalloc_alloc (struct bitalloc *, size_t cnt);
+size_t bitalloc_alloc_from (struct bitalloc *, size_t home, size_t cnt);
+void bitalloc_free (struct bitalloc *, size_t idx, size_t cnt);
+
+/* Information. */
+size_t bitalloc_size (const struct bitalloc *);
+size_t bitalloc_shard_cnt (const struct bitalloc *);
+size_t bitalloc_home (const struct bitalloc *);
+size_t bitalloc_available (const struct bitalloc *);
+
+#endif /* bitalloc.h */
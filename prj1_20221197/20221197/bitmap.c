@@ -1,17 +1,29 @@
+/* For mremap(). */
+#define _GNU_SOURCE 1
+
 #include "bitmap.h"
 #include <assert.h>	
+#include <pthread.h>
 #include "limits.h"	// 		#include <limits.h>
 #include "round.h"	// 		#include <round.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>	
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 
 #include "hex_dump.h"	
+#include "simd.h"
 #define ASSERT(CONDITION) assert(CONDITION)	
 
 /* Element type.
 
    This must be an unsigned integer type at least as wide as int.
+   It must also match the element type of the kernels in
+   simd.h, which run the bulk loops below.
 
    Each bit represents one bit in the bitmap.
    If bit 0 in an element represents bit K in the bitmap,
@@ -29,6 +41,102 @@ struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
     elem_type *bits;    /* Elements that represent bits. */
+    struct bitmap_index *index; /* Summary index, or a null pointer. */
+    struct bitmap_rank *rank;   /* Rank directory, or a null pointer. */
+    struct bitmap_cow *cow;     /* Snapshot state, or a null pointer. */
+    bool mapped;        /* BITS was obtained from mmap(). */
+  };
+
+/* Number of levels in a summary index. */
+#define INDEX_LEVELS 3
+
+/* Summary index over a bitmap, for bitmap_create_indexed().
+
+   Level 0 has one bit per element of the bitmap, and each higher
+   level has one bit per element of the level below it.  For each
+   VALUE there is a separate hierarchy: bit K of any[VALUE][0] is
+   set if element K of the bitmap contains a bit equal to VALUE,
+   and bit K of any[VALUE][L] is set if element K of
+   any[VALUE][L - 1] is nonzero.  A search for a bit equal to
+   VALUE can therefore skip 64**(L + 1) elements of the bitmap
+   that contain no such bit by looking at a single bit of level L.
+
+   With 64-bit elements the index costs about 1/32 of the
+   bitmap's own size. */
+struct bitmap_index
+  {
+    size_t bit_cnt[INDEX_LEVELS];       /* Number of bits per level. */
+    elem_type *any[2][INDEX_LEVELS];    /* Summary bits. */
+  };
+
+/* Bits per block and per sub-block of a rank directory. */
+#define RANK_BLOCK_BITS 2048
+#define RANK_SUB_BITS 512
+
+/* Rank directory over a bitmap, for bitmap_enable_rank().
+
+   The bitmap is divided into blocks of RANK_BLOCK_BITS bits, each
+   made of four sub-blocks of RANK_SUB_BITS bits.  For each block
+   the directory records the number of set bits before it, in 64
+   bits, and the populations of its first three sub-blocks, in 10
+   bits each packed into 32 bits.  That is 96 bits per 2048 bits
+   of bitmap, or about 4.7%.
+
+   The entries are computed lazily.  Entries for the first
+   VALID_CNT blocks are known to be correct, and so is BEFORE for
+   the block after them.  A change to an element lowers
+   VALID_CNT to the element's block, and a query raises it again
+   as far as it needs, so a series of updates costs nothing
+   until the next query. */
+struct bitmap_rank
+  {
+    size_t block_cnt;           /* Number of blocks. */
+    size_t valid_cnt;           /* Number of blocks up to date. */
+    uint64_t *before;           /* Set bits before each block. */
+    uint32_t *sub;              /* Packed sub-block populations. */
+  };
+
+/* Number of elements in a snapshot chunk, one page's worth. */
+#define CHUNK_ELEMS (4096 / sizeof (elem_type))
+
+/* Elements of a chunk of a bitmap as they were when one or more
+   snapshots were taken, saved just before the bitmap first
+   changed them afterward.  Every snapshot that still shared the
+   chunk with the bitmap at that point refers to the same copy. */
+struct saved_chunk
+  {
+    atomic_size_t ref_cnt;      /* Number of snapshots using it. */
+    elem_type elems[];          /* Up to CHUNK_ELEMS elements. */
+  };
+
+/* Copy-on-write state of a bitmap with snapshots, for
+   bitmap_snapshot().
+
+   The bitmap's elements are divided into chunks of CHUNK_ELEMS
+   elements.  A snapshot starts out sharing every chunk with the
+   bitmap.  SHARED[C] is true as long as some snapshot still
+   shares chunk C, and before an update changes an element of such
+   a chunk, the chunk is copied into a struct saved_chunk for the
+   snapshots that share it.  Updates to chunks that no snapshot
+   shares only pay for reading SHARED. */
+struct bitmap_cow
+  {
+    pthread_mutex_t lock;       /* Guards the members below and the
+                                   CHUNKS arrays of SNAPSHOTS. */
+    size_t chunk_cnt;           /* Number of chunks. */
+    atomic_bool *shared;        /* Whether each chunk is shared. */
+    struct bitmap_snapshot *snapshots;  /* List of snapshots. */
+  };
+
+/* Snapshot of a bitmap.  CHUNKS[C] is a null pointer while chunk
+   C is still shared with BITMAP.  Once BITMAP is destroyed or
+   resized, every chunk is saved and BITMAP becomes null. */
+struct bitmap_snapshot
+  {
+    struct bitmap *bitmap;              /* Source, or null. */
+    size_t bit_cnt;                     /* Number of bits. */
+    struct saved_chunk **chunks;        /* Saved chunks. */
+    struct bitmap_snapshot *next;       /* Next snapshot of BITMAP. */
   };
 
 /* Returns the index of the element that contains the bit
@@ -61,21 +169,476 @@ byte_cnt (size_t bit_cnt)
   return sizeof (elem_type) * elem_cnt (bit_cnt);
 }
 
+/* Returns a bit mask in which the bits of the element containing
+   bit END - 1 at or below END - 1's position are set to 1, that
+   is, the bits that precede bit END. */
+static inline elem_type
+tail_mask (size_t end)
+{
+  int last_bits = end % ELEM_BITS;
+  return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
+}
+
 /* Returns a bit mask in which the bits actually used in the last
    element of B's bits are set to 1 and the rest are set to 0. */
 static inline elem_type
 last_mask (const struct bitmap *b) 
 {
-  int last_bits = b->bit_cnt % ELEM_BITS;
-  return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
+  return tail_mask (b->bit_cnt);
+}
+
+/* Returns a bit mask in which the bits of the element containing
+   BIT_IDX at or above BIT_IDX's position are set to 1. */
+static inline elem_type
+head_mask (size_t bit_idx)
+{
+  return (elem_type) -1 << (bit_idx % ELEM_BITS);
+}
+
+/* Returns the number of 1 bits in element E. */
+static inline size_t
+elem_popcount (elem_type e)
+{
+  return __builtin_popcountl (e);
+}
+
+/* Returns the index of the lowest 1 bit in nonzero element E. */
+static inline size_t
+elem_ctz (elem_type e)
+{
+  return __builtin_ctzl (e);
+}
+
+/* Returns the position of the 1 bit in element E that has K 1
+   bits below it.  E must have more than K bits set. */
+static inline size_t
+elem_select (elem_type e, size_t k)
+{
+  while (k-- > 0)
+    e &= e - 1;
+  return elem_ctz (e);
+}
+
+/* Returns element E if VALUE is true, otherwise its complement,
+   so that the bits equal to VALUE become the 1 bits. */
+static inline elem_type
+elem_match (elem_type e, bool value)
+{
+  return value ? e : ~e;
+}
+
+/* Sets the bits selected by MASK in element IDX of B to VALUE. */
+static inline void
+elem_set_masked (struct bitmap *b, size_t idx, elem_type mask, bool value)
+{
+  if (value)
+    b->bits[idx] |= mask;
+  else
+    b->bits[idx] &= ~mask;
+}
+
+/* Returns element IDX of B viewed as an atomic object. */
+static inline _Atomic elem_type *
+atomic_elem (const struct bitmap *b, size_t idx)
+{
+  return (_Atomic elem_type *) &b->bits[idx];
+}
+
+/* Returns element IDX of B.  The load is atomic, so that
+   searches may run while other threads update B through the
+   atomic operations. */
+static inline elem_type
+elem_load (const struct bitmap *b, size_t idx)
+{
+  return atomic_load_explicit (atomic_elem (b, idx), memory_order_relaxed);
+}
+
+/* Returns the mask of the bits in element IDX that lie between
+   bits START and END, exclusive. */
+static inline elem_type
+range_mask (size_t idx, size_t start, size_t end)
+{
+  elem_type mask = (elem_type) -1;
+  if (idx == elem_idx (start))
+    mask &= head_mask (start);
+  if (idx == elem_idx (end - 1))
+    mask &= tail_mask (end);
+  return mask;
+}
+
+/* Summary index. */
+
+/* Sets bit K in summary level LEVEL to VALUE. */
+static inline void
+level_set (elem_type *level, size_t k, bool value)
+{
+  if (value)
+    level[elem_idx (k)] |= bit_mask (k);
+  else
+    level[elem_idx (k)] &= ~bit_mask (k);
+}
+
+/* Allocates and returns a summary index for the bitmap with
+   BIT_CNT bits, with every summary bit false, or a null pointer
+   if memory allocation failed. */
+static struct bitmap_index *
+index_create (size_t bit_cnt)
+{
+  struct bitmap_index *ix;
+  size_t level_elems[INDEX_LEVELS];
+  size_t total, cnt;
+  elem_type *p;
+  int value, level;
+
+  total = 0;
+  cnt = elem_cnt (bit_cnt);
+  for (level = 0; level < INDEX_LEVELS; level++)
+    {
+      level_elems[level] = elem_cnt (cnt);
+      total += level_elems[level];
+      cnt = level_elems[level];
+    }
+
+  ix = calloc (1, sizeof *ix + 2 * total * sizeof (elem_type));
+  if (ix == NULL)
+    return NULL;
+
+  p = (elem_type *) (ix + 1);
+  cnt = elem_cnt (bit_cnt);
+  for (level = 0; level < INDEX_LEVELS; level++)
+    {
+      ix->bit_cnt[level] = cnt;
+      for (value = 0; value < 2; value++)
+        {
+          ix->any[value][level] = p;
+          p += level_elems[level];
+        }
+      cnt = level_elems[level];
+    }
+  return ix;
+}
+
+/* Brings B's summary index up to date after a change to the
+   elements numbered FIRST through LAST, inclusive. */
+static void
+index_update (struct bitmap *b, size_t first, size_t last)
+{
+  struct bitmap_index *ix = b->index;
+  size_t last_elem = elem_cnt (b->bit_cnt) - 1;
+  size_t i;
+  int level;
+
+  for (i = first; i <= last; i++)
+    {
+      elem_type valid = i == last_elem ? last_mask (b) : (elem_type) -1;
+      level_set (ix->any[true][0], i, (b->bits[i] & valid) != 0);
+      level_set (ix->any[false][0], i, (~b->bits[i] & valid) != 0);
+    }
+
+  for (level = 1; level < INDEX_LEVELS; level++)
+    {
+      first = elem_idx (first);
+      last = elem_idx (last);
+      for (i = first; i <= last; i++)
+        {
+          level_set (ix->any[true][level], i,
+                     ix->any[true][level - 1][i] != 0);
+          level_set (ix->any[false][level], i,
+                     ix->any[false][level - 1][i] != 0);
+        }
+    }
+}
+
+/* Returns the lowest bit number at or after K that is set in
+   level LEVEL of IX's hierarchy for VALUE, or SIZE_MAX if there
+   is none. */
+static size_t
+index_next (const struct bitmap_index *ix, bool value, int level, size_t k)
+{
+  const elem_type *bits = ix->any[value][level];
+  size_t idx, cnt;
+  elem_type e;
+
+  if (k >= ix->bit_cnt[level])
+    return SIZE_MAX;
+
+  idx = elem_idx (k);
+  e = bits[idx] & head_mask (k);
+  if (e == 0)
+    {
+      if (level + 1 < INDEX_LEVELS)
+        {
+          idx = index_next (ix, value, level + 1, idx + 1);
+          if (idx == SIZE_MAX)
+            return SIZE_MAX;
+        }
+      else
+        {
+          cnt = elem_cnt (ix->bit_cnt[level]);
+          do
+            if (++idx >= cnt)
+              return SIZE_MAX;
+          while (bits[idx] == 0);
+        }
+      e = bits[idx];
+    }
+  return idx * ELEM_BITS + elem_ctz (e);
+}
+
+/* Rank directory. */
+
+/* Allocates and returns a rank directory for a bitmap with
+   BIT_CNT bits, with no entries computed yet, or a null pointer
+   if memory allocation failed. */
+static struct bitmap_rank *
+rank_create (size_t bit_cnt)
+{
+  size_t block_cnt = DIV_ROUND_UP (bit_cnt, RANK_BLOCK_BITS);
+  struct bitmap_rank *r;
+
+  r = malloc (sizeof *r + (block_cnt + 1) * sizeof *r->before
+              + block_cnt * sizeof *r->sub);
+  if (r == NULL)
+    return NULL;
+  r->block_cnt = block_cnt;
+  r->valid_cnt = 0;
+  r->before = (uint64_t *) (r + 1);
+  r->sub = (uint32_t *) (r->before + block_cnt + 1);
+  r->before[0] = 0;
+  return r;
+}
+
+/* Computes the entries of B's rank directory for the blocks
+   before block number END that are not up to date. */
+static void
+rank_refresh (const struct bitmap *b, size_t end)
+{
+  struct bitmap_rank *r = b->rank;
+  size_t last_elem = elem_cnt (b->bit_cnt) - 1;
+
+  for (; r->valid_cnt < end; r->valid_cnt++)
+    {
+      size_t blk = r->valid_cnt;
+      size_t first = blk * (RANK_BLOCK_BITS / ELEM_BITS);
+      size_t cnt[4] = { 0, 0, 0, 0 };
+      size_t end = first + RANK_BLOCK_BITS / ELEM_BITS;
+      size_t i;
+
+      if (end > last_elem + 1)
+        end = last_elem + 1;
+      for (i = first; i < end; i++)
+        {
+          elem_type e = elem_load (b, i);
+          if (i == last_elem)
+            e &= last_mask (b);
+          cnt[(i - first) * ELEM_BITS / RANK_SUB_BITS] += elem_popcount (e);
+        }
+      r->sub[blk] = cnt[0] | cnt[1] << 10 | cnt[2] << 20;
+      r->before[blk + 1] = (r->before[blk]
+                            + cnt[0] + cnt[1] + cnt[2] + cnt[3]);
+    }
+}
+
+/* Snapshot chunks. */
+
+/* Copies chunk C of B into a new struct saved_chunk for each
+   snapshot of B that still shares it, which must be at least one.
+   B's copy-on-write lock must be held.  There is no way to report
+   failure to the update that triggered the copy, so running out
+   of memory here is fatal. */
+static void
+chunk_save (struct bitmap *b, size_t c)
+{
+  struct bitmap_cow *cow = b->cow;
+  size_t first = c * CHUNK_ELEMS;
+  size_t cnt = elem_cnt (b->bit_cnt) - first;
+  struct saved_chunk *chunk;
+  struct bitmap_snapshot *s;
+
+  if (cnt > CHUNK_ELEMS)
+    cnt = CHUNK_ELEMS;
+  chunk = malloc (sizeof *chunk + cnt * sizeof (elem_type));
+  if (chunk == NULL)
+    {
+      fprintf (stderr, "bitmap: out of memory saving snapshot chunk\n");
+      abort ();
+    }
+  memcpy (chunk->elems, b->bits + first, cnt * sizeof (elem_type));
+  atomic_init (&chunk->ref_cnt, 0);
+  for (s = cow->snapshots; s != NULL; s = s->next)
+    if (s->chunks[c] == NULL)
+      {
+        s->chunks[c] = chunk;
+        atomic_fetch_add (&chunk->ref_cnt, 1);
+      }
+  atomic_store_explicit (&cow->shared[c], false, memory_order_relaxed);
+}
+
+/* Releases one snapshot's reference to CHUNK, which may be a
+   null pointer. */
+static void
+chunk_release (struct saved_chunk *chunk)
+{
+  if (chunk != NULL && atomic_fetch_sub (&chunk->ref_cnt, 1) == 1)
+    free (chunk);
+}
+
+/* Saves every chunk of B in the elements numbered FIRST through
+   LAST, inclusive, that a snapshot still shares. */
+static void
+chunks_unshare (struct bitmap *b, size_t first, size_t last)
+{
+  struct bitmap_cow *cow = b->cow;
+  size_t c;
+
+  for (c = first / CHUNK_ELEMS; c <= last / CHUNK_ELEMS; c++)
+    if (atomic_load_explicit (&cow->shared[c], memory_order_acquire))
+      {
+        pthread_mutex_lock (&cow->lock);
+        if (atomic_load_explicit (&cow->shared[c], memory_order_relaxed))
+          chunk_save (b, c);
+        pthread_mutex_unlock (&cow->lock);
+      }
+}
+
+/* Saves every chunk of B that a snapshot still shares, cuts the
+   snapshots loose from B and frees B's copy-on-write state.
+   Afterward the snapshots no longer depend on B's storage. */
+static void
+cow_detach (struct bitmap *b)
+{
+  struct bitmap_cow *cow = b->cow;
+  struct bitmap_snapshot *s;
+  size_t c;
+
+  if (cow == NULL)
+    return;
+  pthread_mutex_lock (&cow->lock);
+  for (c = 0; c < cow->chunk_cnt; c++)
+    if (atomic_load_explicit (&cow->shared[c], memory_order_relaxed))
+      chunk_save (b, c);
+  for (s = cow->snapshots; s != NULL; s = s->next)
+    s->bitmap = NULL;
+  pthread_mutex_unlock (&cow->lock);
+
+  pthread_mutex_destroy (&cow->lock);
+  free (cow->shared);
+  free (cow);
+  b->cow = NULL;
+}
+
+/* Prepares for a change to the elements numbered FIRST through
+   LAST, inclusive, in B, by saving any of them that a snapshot
+   still shares. */
+static inline void
+elems_changing (struct bitmap *b, size_t first, size_t last)
+{
+  if (b->cow != NULL)
+    chunks_unshare (b, first, last);
+}
+
+/* Records a change to the elements numbered FIRST through LAST,
+   inclusive, in B. */
+static inline void
+elems_changed (struct bitmap *b, size_t first, size_t last)
+{
+  if (b->index != NULL)
+    index_update (b, first, last);
+  if (b->rank != NULL
+      && b->rank->valid_cnt > first / (RANK_BLOCK_BITS / ELEM_BITS))
+    b->rank->valid_cnt = first / (RANK_BLOCK_BITS / ELEM_BITS);
 }
 
 /* Creation and destruction. */
 
+/* Element arrays of at least this many bytes are mapped
+   directly with mmap() instead of coming from the heap.  The
+   kernel supplies such pages already zeroed and only faults them
+   in when they are first touched, so creating a large bitmap
+   takes constant time however many bits it has. */
+#define MAP_THRESHOLD (256 * 1024)
+
+/* Mappings of at least this many bytes are aligned to, and
+   advised to use, transparent huge pages, which cuts the number
+   of page faults and TLB misses when the bitmap is used. */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* Returns the length of the mapping that holds the elements of
+   a mapped bitmap with BIT_CNT bits. */
+static size_t
+map_size (size_t bit_cnt)
+{
+  size_t size = byte_cnt (bit_cnt);
+  if (size >= HUGE_PAGE_SIZE)
+    return ROUND_UP (size, HUGE_PAGE_SIZE);
+  else
+    return ROUND_UP (size, (size_t) sysconf (_SC_PAGESIZE));
+}
+
+/* Maps SIZE bytes of zeroed memory, where SIZE is a value
+   returned by map_size().  Mappings of huge page size are
+   aligned on a huge page boundary by mapping an extra huge page
+   and unmapping the misaligned ends.  Returns a null pointer if
+   the mapping fails. */
+static void *
+map_zeroed (size_t size)
+{
+  size_t extra = size >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : 0;
+  char *base, *start;
+
+  base = mmap (NULL, size + extra, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    return NULL;
+  if (extra == 0)
+    return base;
+
+  start = (char *) ROUND_UP ((uintptr_t) base, HUGE_PAGE_SIZE);
+  if (start > base)
+    munmap (base, start - base);
+  if (start < base + extra)
+    munmap (start + size, base + extra - start);
+#ifdef MADV_HUGEPAGE
+  madvise (start, size, MADV_HUGEPAGE);
+#endif
+  return start;
+}
+
+/* Allocates zeroed elements for B, which must have its bit_cnt
+   member set.  Returns true if successful, false if memory
+   allocation failed. */
+static bool
+elems_alloc (struct bitmap *b)
+{
+  size_t size = byte_cnt (b->bit_cnt);
+
+  b->mapped = size >= MAP_THRESHOLD;
+  if (b->mapped)
+    {
+      b->bits = map_zeroed (map_size (b->bit_cnt));
+      if (b->bits != NULL)
+        return true;
+      b->mapped = false;
+    }
+  b->bits = calloc (1, size);
+  return b->bits != NULL || size == 0;
+}
+
+/* Frees the elements of B. */
+static void
+elems_free (struct bitmap *b)
+{
+  if (b->mapped)
+    munmap (b->bits, map_size (b->bit_cnt));
+  else
+    free (b->bits);
+}
+
 /* Initializes B to be a bitmap of BIT_CNT bits
    and sets all of its bits to false.
    Returns true if success, false if memory allocation
-   failed. */
+   failed.  Large bitmaps are backed by pages that are only
+   faulted in when first used. */
 struct bitmap *
 bitmap_create (size_t bit_cnt) 
 {
@@ -83,17 +646,39 @@ bitmap_create (size_t bit_cnt)
   if (b != NULL)
     {
       b->bit_cnt = bit_cnt;
-      b->bits = malloc (byte_cnt (bit_cnt));
-      if (b->bits != NULL || bit_cnt == 0)
-        {
-          bitmap_set_all (b, false);
-          return b;
-        }
+      b->index = NULL;
+      b->rank = NULL;
+      b->cow = NULL;
+      if (elems_alloc (b))
+        return b;
       free (b);
     }
   return NULL;
 }
 
+/* Like bitmap_create(), but also maintains a summary index
+   that lets bitmap_scan() and bitmap_scan_and_flip() skip over
+   long stretches of elements that cannot contain a match in
+   logarithmic time.  Every modification keeps the index up to
+   date, at some cost to the speed of single-bit updates. */
+struct bitmap *
+bitmap_create_indexed (size_t bit_cnt)
+{
+  struct bitmap *b = bitmap_create (bit_cnt);
+  if (b != NULL)
+    {
+      b->index = index_create (bit_cnt);
+      if (b->index == NULL)
+        {
+          bitmap_destroy (b);
+          return NULL;
+        }
+      if (bit_cnt > 0)
+        index_update (b, 0, elem_cnt (bit_cnt) - 1);
+    }
+  return b;
+}
+
 /* Creates and returns a bitmap with BIT_CNT bits in the
    BLOCK_SIZE bytes of storage preallocated at BLOCK.
    BLOCK_SIZE must be at least bitmap_needed_bytes(BIT_CNT). */
@@ -107,6 +692,10 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size )
 
   b->bit_cnt = bit_cnt;
   b->bits = (elem_type *) (b + 1);
+  b->index = NULL;
+  b->rank = NULL;
+  b->cow = NULL;
+  b->mapped = false;
   bitmap_set_all (b, false);
   return b;
 }
@@ -119,7 +708,8 @@ bitmap_buf_size (size_t bit_cnt)
   return sizeof (struct bitmap) + byte_cnt (bit_cnt);
 }
 
-/* Destroys bitmap B, freeing its storage.
+/* Destroys bitmap B, freeing its storage.  Snapshots of B
+   remain valid.
    Not for use on bitmaps created by
    bitmap_create_preallocated(). */
 void
@@ -127,7 +717,10 @@ bitmap_destroy (struct bitmap *b)
 {
   if (b != NULL) 
     {
-      free (b->bits);
+      cow_detach (b);
+      free (b->index);
+      free (b->rank);
+      elems_free (b);
       free (b);
     }
 }
@@ -141,6 +734,108 @@ bitmap_size (const struct bitmap *b)
   return b->bit_cnt;
 }
 
+/* Changes the number of bits in B to BIT_CNT.  Bits below both
+   the old and the new size keep their values, and bits added at
+   the end are set to false.  The element array is resized in
+   place where possible, by realloc() for small bitmaps and by
+   mremap() for mapped ones, which moves pages instead of copying
+   them.  Returns true if successful, false if memory allocation
+   failed, in which case B is unchanged.  A summary index or
+   rank directory is rebuilt for the new size.  Snapshots of B
+   keep their old size and contents.
+   Not for use on bitmaps created by bitmap_create_in_buf(). */
+bool
+bitmap_resize (struct bitmap *b, size_t bit_cnt)
+{
+  size_t old_cnt = b->bit_cnt;
+  size_t old_size = byte_cnt (old_cnt);
+  size_t new_size = byte_cnt (bit_cnt);
+  size_t dirty_end;             /* End of possibly stale storage. */
+  struct bitmap_index *index = NULL;
+  struct bitmap_rank *rank = NULL;
+
+  if (b->index != NULL)
+    {
+      index = index_create (bit_cnt);
+      if (index == NULL)
+        return false;
+    }
+  if (b->rank != NULL)
+    {
+      rank = rank_create (bit_cnt);
+      if (rank == NULL)
+        goto fail;
+    }
+  cow_detach (b);
+
+  if (b->mapped && new_size >= MAP_THRESHOLD)
+    {
+      void *bits = mremap (b->bits, map_size (old_cnt), map_size (bit_cnt),
+                           MREMAP_MAYMOVE);
+      if (bits == MAP_FAILED)
+        goto fail;
+      b->bits = bits;
+
+      /* A shrink may have left stale data in the old mapping
+         past OLD_SIZE, but pages added by mremap() are zero. */
+      dirty_end = map_size (old_cnt);
+    }
+  else if (!b->mapped && new_size < MAP_THRESHOLD)
+    {
+      elem_type *bits = realloc (b->bits, new_size);
+      if (bits == NULL && new_size > 0)
+        goto fail;
+      b->bits = bits;
+      dirty_end = new_size;
+    }
+  else
+    {
+      /* Crossing MAP_THRESHOLD: move to the other kind of
+         storage, which copies at most MAP_THRESHOLD bytes. */
+      struct bitmap new = { .bit_cnt = bit_cnt };
+      if (!elems_alloc (&new))
+        goto fail;
+      memcpy (new.bits, b->bits, old_size < new_size ? old_size : new_size);
+      elems_free (b);
+      b->bits = new.bits;
+      b->mapped = new.mapped;
+      dirty_end = 0;
+    }
+  b->bit_cnt = bit_cnt;
+
+  if (bit_cnt > old_cnt)
+    {
+      /* Clear the new bits, which may hold garbage from the
+         allocator or stale data left behind by an earlier
+         shrink. */
+      if (old_cnt % ELEM_BITS != 0)
+        b->bits[old_cnt / ELEM_BITS] &= tail_mask (old_cnt);
+      if (dirty_end > new_size)
+        dirty_end = new_size;
+      if (dirty_end > old_size)
+        memset ((char *) b->bits + old_size, 0, dirty_end - old_size);
+    }
+
+  if (index != NULL)
+    {
+      free (b->index);
+      b->index = index;
+      if (bit_cnt > 0)
+        index_update (b, 0, elem_cnt (bit_cnt) - 1);
+    }
+  if (rank != NULL)
+    {
+      free (b->rank);
+      b->rank = rank;
+    }
+  return true;
+
+ fail:
+  free (index);
+  free (rank);
+  return false;
+}
+
 /* Setting and testing single bits. */
 
 /* Atomically sets the bit numbered IDX in B to VALUE. */
@@ -162,10 +857,19 @@ bitmap_mark (struct bitmap *b, size_t bit_idx)
   size_t idx = elem_idx (bit_idx);
   elem_type mask = bit_mask (bit_idx);
 
+  elems_changing (b, idx, idx);
+
   /* This is equivalent to `b->bits[idx] |= mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the OR instruction in [IA32-v2b]. */
-  asm ("orl %k1, %k0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+     is atomic even on a multiprocessor machine.  See the
+     descriptions of the OR instruction and the LOCK prefix in
+     [IA32-v2b] and [IA32-v2a]. */
+#ifdef __x86_64__
+  asm volatile ("lock orq %1, %0"
+                : "+m" (b->bits[idx]) : "r" (mask) : "cc", "memory");
+#else
+  atomic_fetch_or (atomic_elem (b, idx), mask);
+#endif
+  elems_changed (b, idx, idx);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -175,10 +879,19 @@ bitmap_reset (struct bitmap *b, size_t bit_idx)
   size_t idx = elem_idx (bit_idx);
   elem_type mask = bit_mask (bit_idx);
 
+  elems_changing (b, idx, idx);
+
   /* This is equivalent to `b->bits[idx] &= ~mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the AND instruction in [IA32-v2a]. */
-  asm ("andl %k1, %k0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+     is atomic even on a multiprocessor machine.  See the
+     descriptions of the AND instruction and the LOCK prefix in
+     [IA32-v2a]. */
+#ifdef __x86_64__
+  asm volatile ("lock andq %1, %0"
+                : "+m" (b->bits[idx]) : "r" (~mask) : "cc", "memory");
+#else
+  atomic_fetch_and (atomic_elem (b, idx), ~mask);
+#endif
+  elems_changed (b, idx, idx);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -190,10 +903,19 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
   size_t idx = elem_idx (bit_idx);
   elem_type mask = bit_mask (bit_idx);
 
+  elems_changing (b, idx, idx);
+
   /* This is equivalent to `b->bits[idx] ^= mask' except that it
-     is guaranteed to be atomic on a uniprocessor machine.  See
-     the description of the XOR instruction in [IA32-v2b]. */
-  asm ("xorl %k1, %k0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+     is atomic even on a multiprocessor machine.  See the
+     descriptions of the XOR instruction and the LOCK prefix in
+     [IA32-v2b] and [IA32-v2a]. */
+#ifdef __x86_64__
+  asm volatile ("lock xorq %1, %0"
+                : "+m" (b->bits[idx]) : "r" (mask) : "cc", "memory");
+#else
+  atomic_fetch_xor (atomic_elem (b, idx), mask);
+#endif
+  elems_changed (b, idx, idx);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -205,6 +927,131 @@ bitmap_test (const struct bitmap *b, size_t idx)
   return (b->bits[elem_idx (idx)] & bit_mask (idx)) != 0;
 }
 
+/* Atomic bit operations.
+
+   These let several threads share a bitmap.  Each one takes the
+   C11 memory order ORDER to apply to its access, so that callers
+   that only need atomicity can ask for memory_order_relaxed and
+   avoid paying for fences they do not need.  On x86-64 every
+   locked read-modify-write is already a full barrier, so ORDER
+   only constrains the compiler there.
+
+   Bitmaps with a summary index (see bitmap_create_indexed()) do
+   not update the index atomically and must not be shared. */
+
+/* Atomically reads and returns the bit numbered IDX in B. */
+bool
+bitmap_atomic_test (const struct bitmap *b, size_t idx, memory_order order)
+{
+  ASSERT (b != NULL);
+  ASSERT (idx < b->bit_cnt);
+  return (atomic_load_explicit (atomic_elem (b, elem_idx (idx)), order)
+          & bit_mask (idx)) != 0;
+}
+
+/* Atomically sets the bit numbered IDX in B to true and returns
+   its previous value. */
+bool
+bitmap_test_and_set (struct bitmap *b, size_t idx, memory_order order)
+{
+  bool old;
+
+  ASSERT (b != NULL);
+  ASSERT (idx < b->bit_cnt);
+  elems_changing (b, elem_idx (idx), elem_idx (idx));
+#ifdef __x86_64__
+  /* See the description of the BTS instruction in [IA32-v2a]. */
+  asm volatile ("lock btsq %2, %0"
+                : "+m" (b->bits[elem_idx (idx)]), "=@ccc" (old)
+                : "r" ((elem_type) (idx % ELEM_BITS)) : "memory");
+  (void) order;
+#else
+  old = (atomic_fetch_or_explicit (atomic_elem (b, elem_idx (idx)),
+                                   bit_mask (idx), order)
+         & bit_mask (idx)) != 0;
+#endif
+  elems_changed (b, elem_idx (idx), elem_idx (idx));
+  return old;
+}
+
+/* Atomically sets the bit numbered IDX in B to false and returns
+   its previous value. */
+bool
+bitmap_test_and_reset (struct bitmap *b, size_t idx, memory_order order)
+{
+  bool old;
+
+  ASSERT (b != NULL);
+  ASSERT (idx < b->bit_cnt);
+  elems_changing (b, elem_idx (idx), elem_idx (idx));
+#ifdef __x86_64__
+  /* See the description of the BTR instruction in [IA32-v2a]. */
+  asm volatile ("lock btrq %2, %0"
+                : "+m" (b->bits[elem_idx (idx)]), "=@ccc" (old)
+                : "r" ((elem_type) (idx % ELEM_BITS)) : "memory");
+  (void) order;
+#else
+  old = (atomic_fetch_and_explicit (atomic_elem (b, elem_idx (idx)),
+                                    ~bit_mask (idx), order)
+         & bit_mask (idx)) != 0;
+#endif
+  elems_changed (b, elem_idx (idx), elem_idx (idx));
+  return old;
+}
+
+/* Atomically toggles the bit numbered IDX in B and returns its
+   previous value. */
+bool
+bitmap_test_and_flip (struct bitmap *b, size_t idx, memory_order order)
+{
+  bool old;
+
+  ASSERT (b != NULL);
+  ASSERT (idx < b->bit_cnt);
+  elems_changing (b, elem_idx (idx), elem_idx (idx));
+#ifdef __x86_64__
+  /* See the description of the BTC instruction in [IA32-v2a]. */
+  asm volatile ("lock btcq %2, %0"
+                : "+m" (b->bits[elem_idx (idx)]), "=@ccc" (old)
+                : "r" ((elem_type) (idx % ELEM_BITS)) : "memory");
+  (void) order;
+#else
+  old = (atomic_fetch_xor_explicit (atomic_elem (b, elem_idx (idx)),
+                                    bit_mask (idx), order)
+         & bit_mask (idx)) != 0;
+#endif
+  elems_changed (b, elem_idx (idx), elem_idx (idx));
+  return old;
+}
+
+/* Atomically sets the CNT bits starting at START in B to VALUE,
+   an element at a time.  Each element is updated atomically
+   with memory order ORDER, but the range as a whole is not. */
+void
+bitmap_set_multiple_atomic (struct bitmap *b, size_t start, size_t cnt,
+                            bool value, memory_order order)
+{
+  size_t i;
+
+  ASSERT (b != NULL);
+  ASSERT (b->index == NULL && b->rank == NULL);
+  ASSERT (start <= b->bit_cnt);
+  ASSERT (start + cnt <= b->bit_cnt);
+
+  if (cnt == 0)
+    return;
+
+  elems_changing (b, elem_idx (start), elem_idx (start + cnt - 1));
+  for (i = elem_idx (start); i <= elem_idx (start + cnt - 1); i++)
+    {
+      elem_type mask = range_mask (i, start, start + cnt);
+      if (value)
+        atomic_fetch_or_explicit (atomic_elem (b, i), mask, order);
+      else
+        atomic_fetch_and_explicit (atomic_elem (b, i), ~mask, order);
+    }
+}
+
 /* Setting and testing multiple bits. */
 
 /* Sets all bits in B to VALUE. */
@@ -216,53 +1063,98 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+
+   The partial elements at either end of the range are updated
+   through masks and the whole elements in between are stored
+   directly, so the cost is proportional to the number of
+   elements touched rather than the number of bits. */
 void
-bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
+bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-  size_t i;
-  
+  size_t first, last;
+  elem_type fill;
+
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  if (cnt == 0)
+    return;
+
+  first = elem_idx (start);
+  last = elem_idx (start + cnt - 1);
+  elems_changing (b, first, last);
+  if (first == last)
+    {
+      elem_set_masked (b, first,
+                       head_mask (start) & tail_mask (start + cnt), value);
+      elems_changed (b, first, last);
+      return;
+    }
+
+  elem_set_masked (b, first, head_mask (start), value);
+  fill = value ? (elem_type) -1 : 0;
+  simd_fill (&b->bits[first + 1], last - first - 1, fill);
+  elem_set_masked (b, last, tail_mask (start + cnt), value);
+  elems_changed (b, first, last);
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t
-bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-  size_t i, value_cnt;
+  size_t first, last, i, value_cnt;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
+  if (cnt == 0)
+    return 0;
+
+  first = elem_idx (start);
+  last = elem_idx (start + cnt - 1);
+  if (first == last)
+    return elem_popcount (elem_match (b->bits[first], value)
+                          & head_mask (start) & tail_mask (start + cnt));
+
+  value_cnt = elem_popcount (elem_match (b->bits[first], value)
+                             & head_mask (start));
+  i = simd_popcount (&b->bits[first + 1], last - first - 1);
+  value_cnt += value ? i : (last - first - 1) * ELEM_BITS - i;
+  value_cnt += elem_popcount (elem_match (b->bits[last], value)
+                              & tail_mask (start + cnt));
   return value_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
-bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-  size_t i;
-  
+  size_t first, last, i;
+
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  if (cnt == 0)
+    return false;
+
+  first = elem_idx (start);
+  last = elem_idx (start + cnt - 1);
+  if (first == last)
+    return (elem_match (b->bits[first], value)
+            & head_mask (start) & tail_mask (start + cnt)) != 0;
+
+  if ((elem_match (b->bits[first], value) & head_mask (start)) != 0)
+    return true;
+  i = last - first - 1;
+  if (simd_find_ne (&b->bits[first + 1], i, value ? 0 : (elem_type) -1) < i)
+    return true;
+  return (elem_match (b->bits[last], value) & tail_mask (start + cnt)) != 0;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -291,10 +1183,54 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /* Finding set or unset bits. */
 
+/* Returns the index of the first bit in B at or after START and
+   before END that is set to VALUE, or END if there is none.
+
+   Elements that contain no bit equal to VALUE are skipped whole,
+   through B's summary index if it has one, and the first
+   matching bit of an element is located with a
+   count-trailing-zeros instruction. */
+static size_t
+find_value (const struct bitmap *b, size_t start, size_t end, bool value)
+{
+  size_t idx, last;
+  elem_type e;
+
+  if (start >= end)
+    return end;
+
+  idx = elem_idx (start);
+  last = elem_idx (end - 1);
+  e = elem_match (elem_load (b, idx), value) & head_mask (start);
+  if (e == 0 && b->index != NULL)
+    {
+      idx = index_next (b->index, value, 0, idx + 1);
+      if (idx > last)
+        return end;
+      e = elem_match (elem_load (b, idx), value);
+    }
+  while (e == 0)
+    {
+      if (++idx > last)
+        return end;
+      e = elem_match (elem_load (b, idx), value);
+    }
+
+  start = idx * ELEM_BITS + elem_ctz (e);
+  return start < end ? start : end;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Rather than testing every candidate starting index, this jumps
+   to the next bit equal to VALUE, measures the run that begins
+   there an element at a time, and resumes the search just past
+   the first bit that ends a run shorter than CNT.  No group that
+   starts within a short run can be long enough, so the result is
+   still the first fit. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
@@ -304,10 +1240,23 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t i = start;
+
+      if (cnt == 0)
+        return i <= last ? i : BITMAP_ERROR;
+
+      while (i <= last)
+        {
+          size_t run_end;
+
+          i = find_value (b, i, last + 1, value);
+          if (i > last)
+            break;
+          run_end = find_value (b, i, i + cnt, !value);
+          if (run_end == i + cnt)
+            return i;
+          i = run_end + 1;
+        }
     }
   return BITMAP_ERROR;
 }
@@ -316,9 +1265,9 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
    START that are all set to VALUE, flips them all to !VALUE,
    and returns the index of the first bit in the group.
    If there is no such group, returns BITMAP_ERROR.
-   If CNT is zero, returns 0.
-   Bits are set atomically, but testing bits is not atomic with
-   setting them. */
+   If CNT is zero, returns START.
+   Testing bits is not atomic with setting them, so B must not be
+   shared between threads; see bitmap_scan_and_flip_atomic(). */
 size_t
 bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
 {
@@ -328,6 +1277,579 @@ bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
   return idx;
 }
 
+/* Tries to flip the CNT bits starting at START in B, which the
+   caller has seen set to VALUE, to !VALUE.  Each element in the
+   range is claimed with a single compare-and-swap, in ascending
+   order.  If some bit in the range no longer equals VALUE, the
+   elements claimed so far are flipped back and false is
+   returned; otherwise, returns true. */
+static bool
+claim_range (struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t end = start + cnt;
+  size_t first = elem_idx (start);
+  size_t last = elem_idx (end - 1);
+  size_t i, j;
+
+  elems_changing (b, first, last);
+  for (i = first; i <= last; i++)
+    {
+      _Atomic elem_type *e = atomic_elem (b, i);
+      elem_type mask = range_mask (i, start, end);
+      elem_type old = atomic_load_explicit (e, memory_order_relaxed);
+
+      do
+        if ((elem_match (old, value) & mask) != mask)
+          {
+            for (j = first; j < i; j++)
+              atomic_fetch_xor_explicit (atomic_elem (b, j),
+                                         range_mask (j, start, end),
+                                         memory_order_relaxed);
+            return false;
+          }
+      while (!atomic_compare_exchange_weak_explicit (e, &old, old ^ mask,
+                                                     memory_order_acquire,
+                                                     memory_order_relaxed));
+    }
+  return true;
+}
+
+/* Like bitmap_scan_and_flip(), but B may be shared among
+   threads that modify it only through this function and the
+   atomic bit operations.  Two threads never claim the same bit:
+   a group that fits in one element is claimed with a single
+   compare-and-swap, and a group that spans elements is claimed
+   an element at a time and released again if another thread
+   got to part of it first, after which the scan starts over.
+   No locks are taken, so some thread always makes progress.
+
+   Claiming has acquire semantics, so a thread that releases a
+   group with bitmap_set_multiple_atomic() and
+   memory_order_release hands over its writes to the next
+   thread that claims the group. */
+size_t
+bitmap_scan_and_flip_atomic (struct bitmap *b, size_t start, size_t cnt,
+                             bool value)
+{
+  ASSERT (b != NULL);
+  ASSERT (b->index == NULL && b->rank == NULL);
+
+  for (;;)
+    {
+      size_t idx = bitmap_scan (b, start, cnt, value);
+      if (idx == BITMAP_ERROR || cnt == 0 || claim_range (b, idx, cnt, value))
+        return idx;
+    }
+}
+
+/* Iterating over bits. */
+
+/* Returns the index of the first bit in B at or after START that
+   is set to true, or BITMAP_ERROR if there is none. */
+size_t
+bitmap_next_set (const struct bitmap *b, size_t start)
+{
+  size_t idx;
+
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+
+  idx = find_value (b, start, b->bit_cnt, true);
+  return idx < b->bit_cnt ? idx : BITMAP_ERROR;
+}
+
+/* Returns the index of the first bit in B at or after START that
+   is set to false, or BITMAP_ERROR if there is none. */
+size_t
+bitmap_next_clear (const struct bitmap *b, size_t start)
+{
+  size_t idx;
+
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+
+  idx = find_value (b, start, b->bit_cnt, false);
+  return idx < b->bit_cnt ? idx : BITMAP_ERROR;
+}
+
+/* Loads element IDX of the bitmap that IT iterates over into IT,
+   without the unused bits of the last element. */
+static void
+iter_load (struct bitmap_iter *it, size_t idx)
+{
+  const struct bitmap *b = it->bitmap;
+
+  it->base = idx * ELEM_BITS;
+  it->bits = elem_load (b, idx);
+  if (idx == elem_cnt (b->bit_cnt) - 1)
+    it->bits &= last_mask (b);
+}
+
+/* Initializes IT to iterate over the bits set to true in B, in
+   ascending order.  For example:
+
+      struct bitmap_iter it;
+      size_t idx;
+
+      bitmap_iter_init (&it, b);
+      while ((idx = bitmap_iter_next (&it)) != BITMAP_ERROR)
+        {
+          ...do something with bit IDX...
+        }
+
+   Modifying B during iteration is allowed, but bits in the
+   current element may be reported as they were when the element
+   was loaded. */
+void
+bitmap_iter_init (struct bitmap_iter *it, const struct bitmap *b)
+{
+  ASSERT (it != NULL);
+  ASSERT (b != NULL);
+
+  it->bitmap = b;
+  it->base = 0;
+  it->bits = 0;
+  if (b->bit_cnt > 0)
+    iter_load (it, 0);
+}
+
+/* Returns the index of the next bit set to true in the bitmap
+   that IT iterates over, or BITMAP_ERROR after the last one.
+
+   Set bits are taken from a copy of the current element with a
+   count-trailing-zeros instruction, and elements with no bits set
+   are skipped as by bitmap_next_set(), so iterating over a sparse
+   bitmap takes time proportional to its set bits plus its
+   elements, or less with a summary index. */
+size_t
+bitmap_iter_next (struct bitmap_iter *it)
+{
+  const struct bitmap *b = it->bitmap;
+  size_t idx;
+
+  while (it->bits == 0)
+    {
+      idx = find_value (b, it->base + ELEM_BITS, b->bit_cnt, true);
+      if (idx >= b->bit_cnt)
+        return BITMAP_ERROR;
+      iter_load (it, elem_idx (idx));
+    }
+  idx = it->base + elem_ctz (it->bits);
+  it->bits &= it->bits - 1;
+  return idx;
+}
+
+/* Rank and select. */
+
+/* Attaches a rank directory to B, which makes bitmap_rank() take
+   constant time and bitmap_select() logarithmic time, at a cost
+   of about 5% of B's size in memory.  The directory is filled
+   in by the first query, in time linear in the number of
+   elements, and afterward only the part after the first
+   modified element is recomputed, when a query next needs it.
+   Returns true if successful, false if memory allocation failed.
+
+   Like the summary index, a rank directory is not compatible
+   with bitmap_scan_and_flip_atomic() or
+   bitmap_set_multiple_atomic(). */
+bool
+bitmap_enable_rank (struct bitmap *b)
+{
+  ASSERT (b != NULL);
+
+  if (b->rank == NULL)
+    b->rank = rank_create (b->bit_cnt);
+  return b->rank != NULL;
+}
+
+/* Returns the number of bits in B before bit IDX that are set to
+   true.  IDX may equal B's size, in which case the whole bitmap
+   is counted.  Without a rank directory this is the same as
+   bitmap_count (B, 0, IDX, true). */
+size_t
+bitmap_rank (const struct bitmap *b, size_t idx)
+{
+  const struct bitmap_rank *r = b->rank;
+  size_t blk, sub, cnt, i;
+
+  ASSERT (b != NULL);
+  ASSERT (idx <= b->bit_cnt);
+
+  if (r == NULL)
+    return bitmap_count (b, 0, idx, true);
+
+  blk = idx / RANK_BLOCK_BITS;
+  if (blk == r->block_cnt)
+    {
+      rank_refresh (b, blk);
+      return r->before[blk];
+    }
+  rank_refresh (b, blk + 1);
+
+  cnt = r->before[blk];
+  sub = idx % RANK_BLOCK_BITS / RANK_SUB_BITS;
+  for (i = 0; i < sub; i++)
+    cnt += (r->sub[blk] >> (10 * i)) & 0x3ff;
+  for (i = (blk * RANK_BLOCK_BITS + sub * RANK_SUB_BITS) / ELEM_BITS;
+       i < elem_idx (idx); i++)
+    cnt += elem_popcount (elem_load (b, i));
+  if (idx % ELEM_BITS != 0)
+    cnt += elem_popcount (elem_load (b, i) & tail_mask (idx));
+  return cnt;
+}
+
+/* Returns the index of the bit in B that is set to true and has
+   K bits set to true before it, that is, of the Kth set bit
+   counting from 0.  Returns BITMAP_ERROR if fewer than K + 1
+   bits are set.  Without a rank directory this takes time
+   linear in the position of the bit. */
+size_t
+bitmap_select (const struct bitmap *b, size_t k)
+{
+  const struct bitmap_rank *r = b->rank;
+  size_t lo, hi, sub, i;
+  elem_type e;
+
+  ASSERT (b != NULL);
+
+  if (r == NULL)
+    {
+      struct bitmap_iter it;
+      size_t idx;
+
+      bitmap_iter_init (&it, b);
+      do
+        idx = bitmap_iter_next (&it);
+      while (idx != BITMAP_ERROR && k-- > 0);
+      return idx;
+    }
+
+  rank_refresh (b, r->block_cnt);
+  if (k >= r->before[r->block_cnt])
+    return BITMAP_ERROR;
+
+  /* Find the last block with at most K set bits before it. */
+  lo = 0;
+  hi = r->block_cnt;
+  while (hi - lo > 1)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (r->before[mid] <= k)
+        lo = mid;
+      else
+        hi = mid;
+    }
+  k -= r->before[lo];
+
+  for (sub = 0; sub < 3; sub++)
+    {
+      size_t cnt = (r->sub[lo] >> (10 * sub)) & 0x3ff;
+      if (k < cnt)
+        break;
+      k -= cnt;
+    }
+  for (i = (lo * RANK_BLOCK_BITS + sub * RANK_SUB_BITS) / ELEM_BITS; ; i++)
+    {
+      e = elem_load (b, i);
+      if (k < elem_popcount (e))
+        break;
+      k -= elem_popcount (e);
+    }
+  return i * ELEM_BITS + elem_select (e, k);
+}
+
+/* Snapshots. */
+
+/* Creates and returns a read-only snapshot of the current
+   contents of B, or a null pointer if memory allocation failed.
+
+   Taking a snapshot costs time proportional to the number of
+   4 kB chunks in B, not to its size in bits: the snapshot shares
+   B's storage, and each chunk is copied only when B is first
+   changed there afterward.  Updates to B, including the atomic
+   ones from several threads, may run concurrently with reads
+   of its snapshots, but not with bitmap_snapshot() itself, so
+   take the snapshot while holding whatever lock the writers of B
+   use.  Not for use on bitmaps created by bitmap_create_in_buf(),
+   since nothing would free the state that the snapshot
+   attaches to B. */
+struct bitmap_snapshot *
+bitmap_snapshot (struct bitmap *b)
+{
+  size_t chunk_cnt = DIV_ROUND_UP (elem_cnt (b->bit_cnt), CHUNK_ELEMS);
+  struct bitmap_snapshot *s;
+  size_t c;
+
+  ASSERT (b != NULL);
+
+  if (b->cow == NULL)
+    {
+      struct bitmap_cow *cow = malloc (sizeof *cow);
+      if (cow == NULL)
+        return NULL;
+      cow->shared = calloc (chunk_cnt, sizeof *cow->shared);
+      if (cow->shared == NULL && chunk_cnt > 0)
+        {
+          free (cow);
+          return NULL;
+        }
+      pthread_mutex_init (&cow->lock, NULL);
+      cow->chunk_cnt = chunk_cnt;
+      cow->snapshots = NULL;
+      b->cow = cow;
+    }
+
+  s = malloc (sizeof *s);
+  if (s == NULL)
+    return NULL;
+  s->chunks = calloc (chunk_cnt, sizeof *s->chunks);
+  if (s->chunks == NULL && chunk_cnt > 0)
+    {
+      free (s);
+      return NULL;
+    }
+  s->bitmap = b;
+  s->bit_cnt = b->bit_cnt;
+
+  pthread_mutex_lock (&b->cow->lock);
+  s->next = b->cow->snapshots;
+  b->cow->snapshots = s;
+  for (c = 0; c < chunk_cnt; c++)
+    atomic_store_explicit (&b->cow->shared[c], true, memory_order_relaxed);
+  pthread_mutex_unlock (&b->cow->lock);
+  return s;
+}
+
+/* Destroys snapshot S, which may be a null pointer. */
+void
+bitmap_snapshot_destroy (struct bitmap_snapshot *s)
+{
+  size_t chunk_cnt, c;
+
+  if (s == NULL)
+    return;
+  chunk_cnt = DIV_ROUND_UP (elem_cnt (s->bit_cnt), CHUNK_ELEMS);
+  if (s->bitmap != NULL)
+    {
+      struct bitmap_cow *cow = s->bitmap->cow;
+      struct bitmap_snapshot **sp, *t;
+
+      pthread_mutex_lock (&cow->lock);
+      for (sp = &cow->snapshots; *sp != s; sp = &(*sp)->next)
+        continue;
+      *sp = s->next;
+
+      /* Stop copying chunks that no other snapshot shares. */
+      for (c = 0; c < chunk_cnt; c++)
+        if (s->chunks[c] == NULL)
+          {
+            for (t = cow->snapshots; t != NULL; t = t->next)
+              if (t->chunks[c] == NULL)
+                break;
+            if (t == NULL)
+              atomic_store_explicit (&cow->shared[c], false,
+                                     memory_order_relaxed);
+          }
+      pthread_mutex_unlock (&cow->lock);
+    }
+  for (c = 0; c < chunk_cnt; c++)
+    chunk_release (s->chunks[c]);
+  free (s->chunks);
+  free (s);
+}
+
+/* Copies the elements of S numbered FIRST through LAST,
+   inclusive, to DST.  Chunks still shared with the source bitmap
+   are read under its lock, so that an update cannot change them
+   halfway through. */
+static void
+snapshot_read (const struct bitmap_snapshot *s, size_t first, size_t last,
+               elem_type *dst)
+{
+  while (first <= last)
+    {
+      size_t c = first / CHUNK_ELEMS;
+      size_t ofs = first % CHUNK_ELEMS;
+      size_t cnt = CHUNK_ELEMS - ofs;
+      struct bitmap_cow *cow = s->bitmap != NULL ? s->bitmap->cow : NULL;
+
+      if (cnt > last - first + 1)
+        cnt = last - first + 1;
+      if (cow != NULL)
+        pthread_mutex_lock (&cow->lock);
+      if (s->chunks[c] != NULL)
+        memcpy (dst, s->chunks[c]->elems + ofs, cnt * sizeof *dst);
+      else
+        memcpy (dst, s->bitmap->bits + first, cnt * sizeof *dst);
+      if (cow != NULL)
+        pthread_mutex_unlock (&cow->lock);
+      dst += cnt;
+      first += cnt;
+    }
+}
+
+/* Returns the number of bits in S. */
+size_t
+bitmap_snapshot_size (const struct bitmap_snapshot *s)
+{
+  return s->bit_cnt;
+}
+
+/* Returns the value of the bit numbered IDX in S. */
+bool
+bitmap_snapshot_test (const struct bitmap_snapshot *s, size_t idx)
+{
+  elem_type e;
+
+  ASSERT (s != NULL);
+  ASSERT (idx < s->bit_cnt);
+  snapshot_read (s, elem_idx (idx), elem_idx (idx), &e);
+  return (e & bit_mask (idx)) != 0;
+}
+
+/* Returns the number of bits in S between START and START + CNT,
+   exclusive, that are set to VALUE. */
+size_t
+bitmap_snapshot_count (const struct bitmap_snapshot *s, size_t start,
+                       size_t cnt, bool value)
+{
+  elem_type buf[CHUNK_ELEMS];
+  size_t end = start + cnt;
+  size_t value_cnt = 0;
+  size_t i, j, n;
+
+  ASSERT (s != NULL);
+  ASSERT (start <= s->bit_cnt);
+  ASSERT (end <= s->bit_cnt);
+
+  if (cnt == 0)
+    return 0;
+  for (i = elem_idx (start); i <= elem_idx (end - 1); i += n)
+    {
+      n = elem_idx (end - 1) - i + 1;
+      if (n > CHUNK_ELEMS)
+        n = CHUNK_ELEMS;
+      snapshot_read (s, i, i + n - 1, buf);
+      for (j = 0; j < n; j++)
+        value_cnt += elem_popcount (buf[j] & range_mask (i + j, start, end));
+    }
+  return value ? value_cnt : cnt - value_cnt;
+}
+
+/* Creates and returns a new bitmap with the contents of S, on
+   which all of the read operations of this module can be used,
+   or a null pointer if memory allocation failed. */
+struct bitmap *
+bitmap_snapshot_copy (const struct bitmap_snapshot *s)
+{
+  struct bitmap *b;
+
+  ASSERT (s != NULL);
+
+  b = bitmap_create (s->bit_cnt);
+  if (b != NULL && s->bit_cnt > 0)
+    snapshot_read (s, 0, elem_cnt (s->bit_cnt) - 1, b->bits);
+  return b;
+}
+
+/* Operations between bitmaps. */
+
+/* Sets DST to A OP B, element by element.  All three bitmaps
+   must have the same size, and DST may be A or B.  The unused
+   bits in the last element of DST are cleared. */
+static void
+set_op (struct bitmap *dst, const struct bitmap *a, const struct bitmap *b,
+        enum simd_op op)
+{
+  size_t cnt;
+
+  ASSERT (dst != NULL && a != NULL && b != NULL);
+  ASSERT (a->bit_cnt == dst->bit_cnt && b->bit_cnt == dst->bit_cnt);
+
+  cnt = elem_cnt (dst->bit_cnt);
+  if (cnt == 0)
+    return;
+  elems_changing (dst, 0, cnt - 1);
+  simd_binop (op, dst->bits, a->bits, b->bits, cnt);
+  dst->bits[cnt - 1] &= last_mask (dst);
+  elems_changed (dst, 0, cnt - 1);
+}
+
+/* Sets each bit in DST to the AND of the corresponding bits in A
+   and B.  The bitmaps must have the same size.  DST may be A or
+   B, so that bitmap_and (a, a, b) intersects A with B in
+   place. */
+void
+bitmap_and (struct bitmap *dst, const struct bitmap *a, const struct bitmap *b)
+{
+  set_op (dst, a, b, SIMD_AND);
+}
+
+/* Sets each bit in DST to the OR of the corresponding bits in A
+   and B.  The bitmaps must have the same size.  DST may be A or
+   B. */
+void
+bitmap_or (struct bitmap *dst, const struct bitmap *a, const struct bitmap *b)
+{
+  set_op (dst, a, b, SIMD_OR);
+}
+
+/* Sets each bit in DST to the XOR of the corresponding bits in A
+   and B.  The bitmaps must have the same size.  DST may be A or
+   B. */
+void
+bitmap_xor (struct bitmap *dst, const struct bitmap *a, const struct bitmap *b)
+{
+  set_op (dst, a, b, SIMD_XOR);
+}
+
+/* Sets each bit in DST to true if the corresponding bit is true
+   in A but false in B, and to false otherwise.  The bitmaps must
+   have the same size.  DST may be A or B. */
+void
+bitmap_andnot (struct bitmap *dst, const struct bitmap *a,
+               const struct bitmap *b)
+{
+  set_op (dst, a, b, SIMD_ANDNOT);
+}
+
+/* Returns the number of bits that are true in both A and B,
+   which must have the same size, without modifying either. */
+size_t
+bitmap_and_count (const struct bitmap *a, const struct bitmap *b)
+{
+  size_t cnt, value_cnt;
+
+  ASSERT (a != NULL && b != NULL);
+  ASSERT (a->bit_cnt == b->bit_cnt);
+
+  cnt = elem_cnt (a->bit_cnt);
+  if (cnt == 0)
+    return 0;
+  value_cnt = simd_popcount_and (a->bits, b->bits, cnt - 1);
+  return value_cnt + elem_popcount (a->bits[cnt - 1] & b->bits[cnt - 1]
+                                    & last_mask (a));
+}
+
+/* Returns true if some bit is true in both A and B, which must
+   have the same size, and false otherwise.  Stops at the first
+   element in which they intersect. */
+bool
+bitmap_intersects (const struct bitmap *a, const struct bitmap *b)
+{
+  size_t cnt;
+
+  ASSERT (a != NULL && b != NULL);
+  ASSERT (a->bit_cnt == b->bit_cnt);
+
+  cnt = elem_cnt (a->bit_cnt);
+  if (cnt == 0)
+    return false;
+  if (simd_intersects (a->bits, b->bits, cnt - 1))
+    return true;
+  return (a->bits[cnt - 1] & b->bits[cnt - 1] & last_mask (a)) != 0;
+}
+
 /* Returns the number of bytes needed to store B in a file. */
 size_t
 bitmap_file_size (const struct bitmap *b) 
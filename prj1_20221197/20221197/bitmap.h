@@ -4,17 +4,20 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <inttypes.h>
+#include <stdatomic.h>
 
 /* Bitmap abstract data type. */
 
 /* Creation and destruction. */
 struct bitmap *bitmap_create (size_t bit_cnt);
+struct bitmap *bitmap_create_indexed (size_t bit_cnt);
 struct bitmap *bitmap_create_in_buf (size_t bit_cnt, void *, size_t byte_cnt);
 size_t bitmap_buf_size (size_t bit_cnt);
 void bitmap_destroy (struct bitmap *);
 
 /* Bitmap size. */
 size_t bitmap_size (const struct bitmap *);
+bool bitmap_resize (struct bitmap *, size_t bit_cnt);
 
 /* Setting and testing single bits. */
 void bitmap_set (struct bitmap *, size_t idx, bool);
@@ -23,6 +26,14 @@ void bitmap_reset (struct bitmap *, size_t idx);
 void bitmap_flip (struct bitmap *, size_t idx);
 bool bitmap_test (const struct bitmap *, size_t idx);
 
+/* Atomic bit operations. */
+bool bitmap_atomic_test (const struct bitmap *, size_t idx, memory_order);
+bool bitmap_test_and_set (struct bitmap *, size_t idx, memory_order);
+bool bitmap_test_and_reset (struct bitmap *, size_t idx, memory_order);
+bool bitmap_test_and_flip (struct bitmap *, size_t idx, memory_order);
+void bitmap_set_multiple_atomic (struct bitmap *, size_t start, size_t cnt,
+                                 bool, memory_order);
+
 /* Setting and testing multiple bits. */
 void bitmap_set_all (struct bitmap *, bool);
 void bitmap_set_multiple (struct bitmap *, size_t start, size_t cnt, bool);
@@ -36,6 +47,52 @@ bool bitmap_all (const struct bitmap *, size_t start, size_t cnt);
 #define BITMAP_ERROR SIZE_MAX
 size_t bitmap_scan (const struct bitmap *, size_t start, size_t cnt, bool);
 size_t bitmap_scan_and_flip (struct bitmap *, size_t start, size_t cnt, bool);
+size_t bitmap_scan_and_flip_atomic (struct bitmap *, size_t start,
+                                    size_t cnt, bool);
+
+/* Iterating over bits. */
+size_t bitmap_next_set (const struct bitmap *, size_t start);
+size_t bitmap_next_clear (const struct bitmap *, size_t start);
+
+/* Iterator over the bits set to true in a bitmap.
+   BITS holds the set bits of the current element, with the same
+   type as the elements inside bitmap.c, that have not been
+   returned yet. */
+struct bitmap_iter
+  {
+    const struct bitmap *bitmap;  /* Bitmap being iterated. */
+    size_t base;                  /* Index of bit 0 of BITS. */
+    unsigned long bits;           /* Remaining set bits. */
+  };
+
+void bitmap_iter_init (struct bitmap_iter *, const struct bitmap *);
+size_t bitmap_iter_next (struct bitmap_iter *);
+
+/* Rank and select. */
+bool bitmap_enable_rank (struct bitmap *);
+size_t bitmap_rank (const struct bitmap *, size_t idx);
+size_t bitmap_select (const struct bitmap *, size_t k);
+
+/* Snapshots. */
+struct bitmap_snapshot *bitmap_snapshot (struct bitmap *);
+void bitmap_snapshot_destroy (struct bitmap_snapshot *);
+size_t bitmap_snapshot_size (const struct bitmap_snapshot *);
+bool bitmap_snapshot_test (const struct bitmap_snapshot *, size_t idx);
+size_t bitmap_snapshot_count (const struct bitmap_snapshot *, size_t start,
+                              size_t cnt, bool);
+struct bitmap *bitmap_snapshot_copy (const struct bitmap_snapshot *);
+
+/* Operations between bitmaps. */
+void bitmap_and (struct bitmap *dst, const struct bitmap *,
+                 const struct bitmap *);
+void bitmap_or (struct bitmap *dst, const struct bitmap *,
+                const struct bitmap *);
+void bitmap_xor (struct bitmap *dst, const struct bitmap *,
+                 const struct bitmap *);
+void bitmap_andnot (struct bitmap *dst, const struct bitmap *,
+                    const struct bitmap *);
+size_t bitmap_and_count (const struct bitmap *, const struct bitmap *);
+bool bitmap_intersects (const struct bitmap *, const struct bitmap *);
 
 /* File input and output. */
 size_t bitmap_file_size (const struct bitmap *);
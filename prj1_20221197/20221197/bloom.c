@@ -0,0 +1,233 @@
+/* Bloom filter.
+
+   See bloom.h for basic information. */
+
+#include "bloom.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "bitmap.h"
+#include "hash.h"
+#include "round.h"
+
+#define ASSERT(CONDITION) assert(CONDITION)
+
+/* Size of a block, in bytes and in bits.  A block is one cache
+   line. */
+#define BLOCK_BYTES 64
+#define BLOCK_BITS (BLOCK_BYTES * 8)
+
+/* Bloom filter. */
+struct bloom
+  {
+    struct bitmap *bits;        /* BLOCK_CNT * BLOCK_BITS bits. */
+    size_t block_cnt;           /* Number of blocks. */
+    int hash_cnt;               /* Bits set per key, "k". */
+    size_t insert_cnt;          /* Number of insertions. */
+    void *buf;                  /* Storage holding BITS. */
+  };
+
+/* Bits that one key maps to: HASH_CNT bits of block BLOCK, the
+   first at offset OFS and each following one STEP further on,
+   wrapping around within the block. */
+struct probe
+  {
+    size_t block;
+    unsigned ofs;
+    unsigned step;
+  };
+
+/* Returns X with every bit mixed into every other bit, using the
+   MurmurHash3 64-bit finalizer. */
+static inline uint64_t
+mix64 (uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+/* Derives the probe sequence for a key from its base hash H1.
+
+   H1 is not used directly: hash_bytes() is FNV-1, which folds in
+   the last byte after its final multiply, so that byte only
+   affects the low 8 bits and keys that differ only at the end
+   would share a block.  Instead H1 goes through a finalizer whose
+   high bits pick the block, and a second, independently mixed
+   value supplies the offset and step.  The step is odd, and
+   therefore relatively prime to BLOCK_BITS, so the first
+   BLOCK_BITS probes are all distinct. */
+static struct probe
+make_probe (const struct bloom *f, unsigned h1)
+{
+  struct probe p;
+  uint64_t x = mix64 (h1);
+  uint32_t h2 = mix64 (x ^ 0x9e3779b97f4a7c15ull);
+
+  p.block = ((x >> 32) * f->block_cnt) >> 32;
+  p.ofs = h2 % BLOCK_BITS;
+  p.step = (h2 / BLOCK_BITS) | 1;
+  return p;
+}
+
+/* Returns the index in F's bitmap of probe I of P. */
+static size_t
+probe_bit (const struct probe *p, int i)
+{
+  return p->block * BLOCK_BITS + (p->ofs + i * p->step) % BLOCK_BITS;
+}
+
+/* Sets the bits for the key with base hash H1 in F. */
+static void
+insert_hash (struct bloom *f, unsigned h1)
+{
+  struct probe p = make_probe (f, h1);
+  int i;
+
+  for (i = 0; i < f->hash_cnt; i++)
+    bitmap_mark (f->bits, probe_bit (&p, i));
+  f->insert_cnt++;
+}
+
+/* Returns true if all of the bits for the key with base hash H1
+   are set in F. */
+static bool
+query_hash (const struct bloom *f, unsigned h1)
+{
+  struct probe p = make_probe (f, h1);
+  int i;
+
+  for (i = 0; i < f->hash_cnt; i++)
+    if (!bitmap_test (f->bits, probe_bit (&p, i)))
+      return false;
+  return true;
+}
+
+/* Creation and destruction. */
+
+/* Creates and returns a Bloom filter of at least BIT_CNT bits,
+   rounded up to a whole number of blocks, that sets HASH_CNT
+   bits per key.  Returns a null pointer if memory allocation
+   failed.
+
+   For N keys, about 1.44 * log2 (1 / P) bits per key and
+   HASH_CNT = (BIT_CNT / N) * ln 2 give a false positive rate
+   near P, e.g. 10 bits per key and HASH_CNT = 7 for 1%. */
+struct bloom *
+bloom_create (size_t bit_cnt, int hash_cnt)
+{
+  struct bloom *f;
+  size_t header, ofs, buf_size;
+
+  ASSERT (hash_cnt > 0);
+
+  f = malloc (sizeof *f);
+  if (f == NULL)
+    return NULL;
+  f->block_cnt = DIV_ROUND_UP (bit_cnt, BLOCK_BITS);
+  if (f->block_cnt == 0)
+    f->block_cnt = 1;
+  f->hash_cnt = hash_cnt;
+  f->insert_cnt = 0;
+
+  /* Place the bitmap so that its bits, which follow the header
+     that bitmap_create_in_buf() writes, start on a line
+     boundary.  Otherwise every block would straddle two lines. */
+  header = bitmap_buf_size (0);
+  ofs = (BLOCK_BYTES - header % BLOCK_BYTES) % BLOCK_BYTES;
+  buf_size = bitmap_buf_size (f->block_cnt * BLOCK_BITS);
+  f->buf = aligned_alloc (BLOCK_BYTES, ROUND_UP (ofs + buf_size, BLOCK_BYTES));
+  if (f->buf == NULL)
+    {
+      free (f);
+      return NULL;
+    }
+  f->bits = bitmap_create_in_buf (f->block_cnt * BLOCK_BITS,
+                                  (char *) f->buf + ofs, buf_size);
+  return f;
+}
+
+/* Destroys Bloom filter F. */
+void
+bloom_destroy (struct bloom *f)
+{
+  if (f != NULL)
+    {
+      free (f->buf);
+      free (f);
+    }
+}
+
+/* Insertion and queries. */
+
+/* Inserts the SIZE bytes at BUF into F as a key. */
+void
+bloom_insert (struct bloom *f, const void *buf, size_t size)
+{
+  insert_hash (f, hash_bytes (buf, size));
+}
+
+/* Returns false if the SIZE bytes at BUF were certainly never
+   inserted into F as a key, true if they probably were. */
+bool
+bloom_query (const struct bloom *f, const void *buf, size_t size)
+{
+  return query_hash (f, hash_bytes (buf, size));
+}
+
+/* Inserts integer I into F as a key. */
+void
+bloom_insert_int (struct bloom *f, int i)
+{
+  insert_hash (f, hash_int (i));
+}
+
+/* Returns false if integer I was certainly never inserted into F,
+   true if it probably was. */
+bool
+bloom_query_int (const struct bloom *f, int i)
+{
+  return query_hash (f, hash_int (i));
+}
+
+/* Removes every key from F. */
+void
+bloom_clear (struct bloom *f)
+{
+  bitmap_set_all (f->bits, false);
+  f->insert_cnt = 0;
+}
+
+/* Information. */
+
+/* Returns the number of bits in F. */
+size_t
+bloom_size (const struct bloom *f)
+{
+  return f->block_cnt * BLOCK_BITS;
+}
+
+/* Returns the number of bits that F sets per key. */
+int
+bloom_hash_cnt (const struct bloom *f)
+{
+  return f->hash_cnt;
+}
+
+/* Returns the number of insertions into F since it was created
+   or last cleared, counting repeated keys each time. */
+size_t
+bloom_insert_cnt (const struct bloom *f)
+{
+  return f->insert_cnt;
+}
+
+/* Returns F's bits, for inspection. */
+const struct bitmap *
+bloom_bitmap (const struct bloom *f)
+{
+  return f->bits;
+}
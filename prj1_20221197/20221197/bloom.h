@@ -0,0 +1,44 @@
+#ifndef __MYLIB_BLOOM_H
+#define __MYLIB_BLOOM_H
+
+/* Bloom filter.
+
+   A Bloom filter answers "might this key have been inserted?"
+   in constant time and space, with no false negatives and a
+   tunable rate of false positives.  Keys themselves are not
+   stored, so they cannot be removed or enumerated.
+
+   The filter is a bitmap divided into blocks of one 64-byte
+   cache line each.  A key's first hash picks its block and its
+   second hash, through double hashing, picks the K bits that it
+   sets within that block, so an insertion or a query touches a
+   single cache line.  The price is a slightly higher false
+   positive rate than an unblocked filter of the same size, since
+   blocks fill unevenly.
+
+   Filters are not safe to use from several threads at once
+   without external locking. */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct bitmap;
+
+/* Creation and destruction. */
+struct bloom *bloom_create (size_t bit_cnt, int hash_cnt);
+void bloom_destroy (struct bloom *);
+
+/* Insertion and queries. */
+void bloom_insert (struct bloom *, const void *, size_t);
+bool bloom_query (const struct bloom *, const void *, size_t);
+void bloom_insert_int (struct bloom *, int);
+bool bloom_query_int (const struct bloom *, int);
+void bloom_clear (struct bloom *);
+
+/* Information. */
+size_t bloom_size (const struct bloom *);
+int bloom_hash_cnt (const struct bloom *);
+size_t bloom_insert_cnt (const struct bloom *);
+const struct bitmap *bloom_bitmap (const struct bloom *);
+
+#endif /* bloom.h */
@@ -0,0 +1,265 @@
+/* Buddy allocator.
+
+   See buddy.h for basic information. */
+
+#include "buddy.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "bitmap.h"
+
+#define ASSERT(CONDITION) assert(CONDITION)
+
+/* Free and allocated blocks of one order.  Block K of order O
+   covers indexes K << O through ((K + 1) << O) - 1.  Only blocks
+   that lie entirely inside the range exist, so a range whose
+   size is not a power of two simply has no buddy for some
+   blocks, which are then never merged. */
+struct order
+  {
+    struct bitmap *free_map;    /* True for each free block. */
+    struct bitmap *used_map;    /* True for each allocated block. */
+    size_t free_cnt;            /* Number of true bits in FREE_MAP. */
+  };
+
+/* Buddy allocator. */
+struct buddy
+  {
+    size_t size;                /* Number of indexes. */
+    size_t avail;               /* Number of free indexes. */
+    int order_cnt;              /* Number of orders. */
+    struct order orders[];      /* Orders 0 through ORDER_CNT - 1. */
+  };
+
+/* Returns the order of the smallest block that holds CNT
+   indexes. */
+static int
+order_for (size_t cnt)
+{
+  int order = 0;
+  while (((size_t) 1 << order) < cnt)
+    order++;
+  return order;
+}
+
+/* Marks block K of order ORDER in A free. */
+static void
+mark_free (struct buddy *a, int order, size_t k)
+{
+  bitmap_mark (a->orders[order].free_map, k);
+  a->orders[order].free_cnt++;
+}
+
+/* Marks free block K of order ORDER in A no longer free. */
+static void
+unmark_free (struct buddy *a, int order, size_t k)
+{
+  bitmap_reset (a->orders[order].free_map, k);
+  a->orders[order].free_cnt--;
+}
+
+/* Creation and destruction. */
+
+/* Creates and returns an allocator for the indexes 0 through
+   SIZE - 1, all of them free.  Returns a null pointer if memory
+   allocation failed. */
+struct buddy *
+buddy_create (size_t size)
+{
+  struct buddy *a;
+  size_t ofs;
+  int order_cnt, o;
+
+  order_cnt = 0;
+  while (order_cnt < (int) (sizeof size * 8) && (size >> order_cnt) > 0)
+    order_cnt++;
+
+  a = calloc (1, sizeof *a + order_cnt * sizeof *a->orders);
+  if (a == NULL)
+    return NULL;
+  a->size = size;
+  a->avail = size;
+  a->order_cnt = order_cnt;
+  for (o = 0; o < order_cnt; o++)
+    {
+      struct order *ord = &a->orders[o];
+      ord->free_map = bitmap_create_indexed (size >> o);
+      ord->used_map = bitmap_create (size >> o);
+      if (ord->free_map == NULL || ord->used_map == NULL)
+        {
+          buddy_destroy (a);
+          return NULL;
+        }
+    }
+
+  /* Cover the range with the largest aligned blocks that fit. */
+  for (ofs = 0; ofs < size; ofs += (size_t) 1 << o)
+    {
+      o = order_cnt - 1;
+      while ((ofs & (((size_t) 1 << o) - 1)) != 0
+             || size - ofs < ((size_t) 1 << o))
+        o--;
+      mark_free (a, o, ofs >> o);
+    }
+  return a;
+}
+
+/* Destroys allocator A.  Blocks still allocated from it become
+   meaningless. */
+void
+buddy_destroy (struct buddy *a)
+{
+  if (a != NULL)
+    {
+      int o;
+
+      for (o = 0; o < a->order_cnt; o++)
+        {
+          bitmap_destroy (a->orders[o].free_map);
+          bitmap_destroy (a->orders[o].used_map);
+        }
+      free (a);
+    }
+}
+
+/* Allocation. */
+
+/* Allocates a block of at least CNT indexes from A, CNT rounded
+   up to a power of two, and returns the first index in the
+   block, which is a multiple of the block's size.  Returns
+   BITMAP_ERROR if no free block is large enough.
+
+   The lowest free block of the smallest sufficient order is
+   split, keeping its lower half each time and freeing the upper
+   half, until it has the requested order. */
+size_t
+buddy_alloc (struct buddy *a, size_t cnt)
+{
+  int order, o;
+  size_t k;
+
+  ASSERT (a != NULL);
+
+  if (cnt > a->size)
+    return BITMAP_ERROR;
+  order = order_for (cnt);
+  for (o = order; o < a->order_cnt; o++)
+    if (a->orders[o].free_cnt > 0)
+      break;
+  if (o >= a->order_cnt)
+    return BITMAP_ERROR;
+
+  k = bitmap_next_set (a->orders[o].free_map, 0);
+  unmark_free (a, o, k);
+  while (o > order)
+    {
+      o--;
+      k *= 2;
+      mark_free (a, o, k + 1);
+    }
+  bitmap_mark (a->orders[order].used_map, k);
+  a->avail -= (size_t) 1 << order;
+  return k << order;
+}
+
+/* Returns the order of the allocated block in A that starts at
+   index IDX, or -1 if there is none. */
+static int
+used_order (const struct buddy *a, size_t idx)
+{
+  int o;
+
+  for (o = 0; o < a->order_cnt && (idx >> o) < (a->size >> o); o++)
+    {
+      if (bitmap_test (a->orders[o].used_map, idx >> o))
+        return o;
+      if ((idx >> o) & 1)
+        break;
+    }
+  return -1;
+}
+
+/* Frees the block that starts at index IDX, which must have been
+   returned by buddy_alloc() on A and not freed since.  The block
+   is merged with its buddy, and the result with its own buddy,
+   for as long as the buddy is free. */
+void
+buddy_free (struct buddy *a, size_t idx)
+{
+  int o;
+  size_t k;
+
+  ASSERT (a != NULL);
+
+  o = used_order (a, idx);
+  ASSERT (o >= 0);
+  k = idx >> o;
+  bitmap_reset (a->orders[o].used_map, k);
+  a->avail += (size_t) 1 << o;
+
+  while (o + 1 < a->order_cnt
+         && (k ^ 1) < bitmap_size (a->orders[o].free_map)
+         && bitmap_test (a->orders[o].free_map, k ^ 1))
+    {
+      unmark_free (a, o, k ^ 1);
+      k /= 2;
+      o++;
+    }
+  mark_free (a, o, k);
+}
+
+/* Returns the number of indexes in the allocated block in A that
+   starts at index IDX, or 0 if no allocated block starts
+   there. */
+size_t
+buddy_block_size (const struct buddy *a, size_t idx)
+{
+  int o = used_order (a, idx);
+  return o >= 0 ? (size_t) 1 << o : 0;
+}
+
+/* Information. */
+
+/* Returns the number of indexes that A manages. */
+size_t
+buddy_size (const struct buddy *a)
+{
+  return a->size;
+}
+
+/* Returns the number of free indexes in A. */
+size_t
+buddy_available (const struct buddy *a)
+{
+  return a->avail;
+}
+
+/* Returns the size of the largest block that A can currently
+   allocate, or 0 if it is full.  The gap between this and
+   buddy_available() measures fragmentation. */
+size_t
+buddy_largest (const struct buddy *a)
+{
+  int o;
+
+  for (o = a->order_cnt - 1; o >= 0; o--)
+    if (a->orders[o].free_cnt > 0)
+      return (size_t) 1 << o;
+  return 0;
+}
+
+/* Returns the number of block orders in A, that is, one more
+   than the order of the largest block it could ever allocate. */
+int
+buddy_order_cnt (const struct buddy *a)
+{
+  return a->order_cnt;
+}
+
+/* Returns the number of free blocks of order ORDER in A. */
+size_t
+buddy_free_blocks (const struct buddy *a, int order)
+{
+  ASSERT (order >= 0 && order < a->order_cnt);
+  return a->orders[order].free_cnt;
+}
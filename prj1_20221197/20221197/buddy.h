@@ -0,0 +1,41 @@
+#ifndef __MYLIB_BUDDY_H
+#define __MYLIB_BUDDY_H
+
+/* Buddy allocator.
+
+   Hands out blocks of consecutive indexes from the range 0 to
+   SIZE - 1.  Every block has a power-of-two length, its "order"
+   being the base-2 logarithm of the length, and starts at a
+   multiple of its length.  A request is rounded up to the next
+   power of two and carved out of the smallest free block that
+   can hold it, splitting that block in halves ("buddies") as
+   often as needed.  When a block is freed, it is merged with its
+   buddy for as long as the buddy is free too, so free space does
+   not splinter the way it does under first-fit allocation.
+
+   Each order has its own bitmaps of free and allocated blocks,
+   and the free bitmaps carry a summary index, so allocation and
+   freeing take O(log SIZE) time however full the range is.
+   Allocators are not safe to use from several threads at once
+   without external locking. */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Creation and destruction. */
+struct buddy *buddy_create (size_t size);
+void buddy_destroy (struct buddy *);
+
+/* Allocation. */
+size_t buddy_alloc (struct buddy *, size_t cnt);
+void buddy_free (struct buddy *, size_t idx);
+size_t buddy_block_size (const struct buddy *, size_t idx);
+
+/* Information. */
+size_t buddy_size (const struct buddy *);
+size_t buddy_available (const struct buddy *);
+size_t buddy_largest (const struct buddy *);
+int buddy_order_cnt (const struct buddy *);
+size_t buddy_free_blocks (const struct buddy *, int order);
+
+#endif /* buddy.h */
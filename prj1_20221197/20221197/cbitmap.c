@@ -0,0 +1,1068 @@
+#include "cbitmap.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hex_dump.h"
+#include "round.h"
+
+#define ASSERT(CONDITION) assert(CONDITION)
+
+/* Compressed bitmap.
+
+   See cbitmap.h for basic information.
+
+   The bits are divided into chunks of CHUNK_BITS bits, and each
+   chunk is kept in a container of whichever of three kinds suits
+   its contents:
+
+   - An array container holds the offsets of the chunk's set bits
+     as a sorted array of 16-bit integers.  It is used for sparse
+     chunks, with at most ARRAY_MAX bits set.
+
+   - A bitset container holds the chunk as a plain array of 64-bit
+     words, like a struct bitmap.  It is used for dense chunks
+     without long runs.
+
+   - A run container holds the chunk's runs of set bits as a
+     sorted array of maximal (start, last) pairs.  It is used for
+     chunks made of a few long runs, including chunks with every
+     bit set.
+
+   A chunk with no bits set is an array container with no
+   elements, which needs no storage beyond the container itself.
+   Bits past the end of the bitmap in its last chunk are always
+   false.
+
+   Single-bit updates change the kind of a container only when it
+   outgrows its current kind: an array becomes a bitset beyond
+   ARRAY_MAX elements, a run container becomes a bitset or an
+   array beyond RUN_MAX runs, and a bitset becomes an array when
+   its population drops to ARRAY_MAX / 2.  The gap between the
+   last two thresholds keeps a chunk whose population hovers
+   around ARRAY_MAX from converting back and forth.  Range
+   updates, which must visit the whole container anyway, finish
+   by converting it to whichever kind is smallest. */
+
+/* Number of bits in a chunk.  Offsets within a chunk fit in
+   16 bits. */
+#define CHUNK_BITS 65536
+
+/* Number of words in a bitset container. */
+#define BITSET_WORDS (CHUNK_BITS / 64)
+
+/* Maximum number of elements in an array container, the point
+   at which it becomes as large as a bitset container. */
+#define ARRAY_MAX 4096
+
+/* Maximum number of runs in a run container, the point at which
+   it becomes as large as a bitset container. */
+#define RUN_MAX 2048
+
+/* Kinds of containers. */
+enum container_type
+  {
+    CONTAINER_ARRAY,            /* Sorted offsets of set bits. */
+    CONTAINER_BITSET,           /* One bit per bit. */
+    CONTAINER_RUN               /* Sorted runs of set bits. */
+  };
+
+/* A run of set bits, from START through LAST, inclusive. */
+struct run
+  {
+    uint16_t start;
+    uint16_t last;
+  };
+
+/* The contents of one chunk. */
+struct container
+  {
+    enum container_type type;   /* Kind of container. */
+    uint32_t card;              /* Number of bits set. */
+    uint32_t cnt;               /* Elements in ARRAY or RUNS. */
+    uint32_t cap;               /* Elements allocated. */
+    union
+      {
+        uint16_t *array;        /* CONTAINER_ARRAY. */
+        uint64_t *words;        /* CONTAINER_BITSET. */
+        struct run *runs;       /* CONTAINER_RUN. */
+      };
+  };
+
+/* A compressed bitmap. */
+struct cbitmap
+  {
+    size_t bit_cnt;             /* Number of bits. */
+    size_t chunk_cnt;           /* Number of chunks. */
+    struct container *chunks;   /* One container per chunk. */
+  };
+
+/* Returns the number of chunks required for BIT_CNT bits. */
+static inline size_t
+chunk_cnt (size_t bit_cnt)
+{
+  return DIV_ROUND_UP (bit_cnt, CHUNK_BITS);
+}
+
+/* Returns the number of bits of B that fall into chunk IDX,
+   which is CHUNK_BITS for every chunk but possibly the last. */
+static inline unsigned
+chunk_size (const struct cbitmap *b, size_t idx)
+{
+  size_t size = b->bit_cnt - idx * CHUNK_BITS;
+  return size < CHUNK_BITS ? size : CHUNK_BITS;
+}
+
+/* Bitset words. */
+
+/* Returns a mask of the bits in a word at and above bit OFS. */
+static inline uint64_t
+word_head_mask (unsigned ofs)
+{
+  return (uint64_t) -1 << (ofs % 64);
+}
+
+/* Returns a mask of the bits in a word below bit END, or of all
+   of them if END is a multiple of 64. */
+static inline uint64_t
+word_tail_mask (unsigned end)
+{
+  return end % 64 ? ((uint64_t) 1 << (end % 64)) - 1 : (uint64_t) -1;
+}
+
+/* Returns the number of 1 bits in WORDS from bit LO up to but not
+   including bit HI. */
+static unsigned
+words_count (const uint64_t *words, unsigned lo, unsigned hi)
+{
+  unsigned first = lo / 64, last = (hi - 1) / 64;
+  unsigned total, i;
+
+  if (lo >= hi)
+    return 0;
+  if (first == last)
+    return __builtin_popcountll (words[first] & word_head_mask (lo)
+                                 & word_tail_mask (hi));
+  total = __builtin_popcountll (words[first] & word_head_mask (lo));
+  for (i = first + 1; i < last; i++)
+    total += __builtin_popcountll (words[i]);
+  return total + __builtin_popcountll (words[last] & word_tail_mask (hi));
+}
+
+/* Sets the bits in WORDS from LO up to but not including HI to
+   VALUE. */
+static void
+words_set_range (uint64_t *words, unsigned lo, unsigned hi, bool value)
+{
+  unsigned first = lo / 64, last = (hi - 1) / 64;
+  unsigned i;
+
+  if (lo >= hi)
+    return;
+  for (i = first; i <= last; i++)
+    {
+      uint64_t mask = (uint64_t) -1;
+      if (i == first)
+        mask &= word_head_mask (lo);
+      if (i == last)
+        mask &= word_tail_mask (hi);
+      if (value)
+        words[i] |= mask;
+      else
+        words[i] &= ~mask;
+    }
+}
+
+/* Containers. */
+
+/* Ensures that C has room for at least CNT elements of SIZE bytes
+   each.  The first allocation is exact and later ones double, so
+   containers built in one pass waste no space.
+
+   Updates have no way to report failure, so running out of
+   memory is fatal. */
+static void
+container_reserve (struct container *c, uint32_t cnt, size_t size)
+{
+  if (cnt > c->cap)
+    {
+      uint32_t cap = c->cap * 2 > cnt ? c->cap * 2 : cnt;
+      void *p = realloc (c->array, (size_t) cap * size);
+      if (p == NULL)
+        {
+          fprintf (stderr, "cbitmap: out of memory growing container\n");
+          abort ();
+        }
+      c->array = p;
+      c->cap = cap;
+    }
+}
+
+/* Frees C's storage, making it an empty array container. */
+static void
+container_clear (struct container *c)
+{
+  free (c->array);
+  c->type = CONTAINER_ARRAY;
+  c->card = c->cnt = c->cap = 0;
+  c->array = NULL;
+}
+
+/* Makes C a run container whose first SIZE bits are set. */
+static void
+container_fill (struct container *c, unsigned size)
+{
+  container_clear (c);
+  container_reserve (c, 1, sizeof *c->runs);
+  c->type = CONTAINER_RUN;
+  c->runs[0].start = 0;
+  c->runs[0].last = size - 1;
+  c->cnt = 1;
+  c->card = size;
+}
+
+/* Returns the index of the first element of array container C
+   that is OFS or greater, or C's element count if there is
+   none. */
+static uint32_t
+array_lower_bound (const struct container *c, unsigned ofs)
+{
+  uint32_t lo = 0, hi = c->cnt;
+  while (lo < hi)
+    {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (c->array[mid] < ofs)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+/* Returns the index of the first run in run container C that
+   starts after OFS, or C's run count if there is none.  The run
+   before it, if any, is the only one that can contain OFS. */
+static uint32_t
+run_upper_bound (const struct container *c, unsigned ofs)
+{
+  uint32_t lo = 0, hi = c->cnt;
+  while (lo < hi)
+    {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (c->runs[mid].start <= ofs)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+/* Returns the value of bit OFS in C. */
+static bool
+container_test (const struct container *c, unsigned ofs)
+{
+  uint32_t i;
+
+  switch (c->type)
+    {
+    case CONTAINER_ARRAY:
+      i = array_lower_bound (c, ofs);
+      return i < c->cnt && c->array[i] == ofs;
+    case CONTAINER_BITSET:
+      return (c->words[ofs / 64] >> (ofs % 64)) & 1;
+    default:
+      i = run_upper_bound (c, ofs);
+      return i > 0 && c->runs[i - 1].last >= ofs;
+    }
+}
+
+/* Returns the number of bits set in C from LO up to but not
+   including HI. */
+static unsigned
+container_count (const struct container *c, unsigned lo, unsigned hi)
+{
+  unsigned total;
+  uint32_t i;
+
+  if (lo >= hi)
+    return 0;
+  switch (c->type)
+    {
+    case CONTAINER_ARRAY:
+      return array_lower_bound (c, hi) - array_lower_bound (c, lo);
+    case CONTAINER_BITSET:
+      return words_count (c->words, lo, hi);
+    default:
+      total = 0;
+      i = run_upper_bound (c, lo);
+      for (i = i > 0 ? i - 1 : 0; i < c->cnt && c->runs[i].start < hi; i++)
+        {
+          unsigned start = c->runs[i].start > lo ? c->runs[i].start : lo;
+          unsigned end = c->runs[i].last + 1u < hi ? c->runs[i].last + 1u : hi;
+          if (start < end)
+            total += end - start;
+        }
+      return total;
+    }
+}
+
+/* Returns the offset of the first bit in C at or after OFS that
+   is set to VALUE, or CHUNK_BITS if there is none. */
+static unsigned
+container_next (const struct container *c, unsigned ofs, bool value)
+{
+  uint32_t i;
+
+  if (ofs >= CHUNK_BITS)
+    return CHUNK_BITS;
+  switch (c->type)
+    {
+    case CONTAINER_ARRAY:
+      i = array_lower_bound (c, ofs);
+      if (value)
+        return i < c->cnt ? c->array[i] : CHUNK_BITS;
+      while (i < c->cnt && c->array[i] == ofs)
+        {
+          ofs++;
+          i++;
+        }
+      return ofs;
+
+    case CONTAINER_BITSET:
+      {
+        size_t w = ofs / 64;
+        uint64_t bits = (value ? c->words[w] : ~c->words[w])
+                        & word_head_mask (ofs);
+        while (bits == 0)
+          {
+            if (++w == BITSET_WORDS)
+              return CHUNK_BITS;
+            bits = value ? c->words[w] : ~c->words[w];
+          }
+        return w * 64 + __builtin_ctzll (bits);
+      }
+
+    default:
+      i = run_upper_bound (c, ofs);
+      if (i > 0 && c->runs[i - 1].last >= ofs)
+        return value ? ofs : c->runs[i - 1].last + 1u;
+      if (!value)
+        return ofs;
+      return i < c->cnt ? c->runs[i].start : CHUNK_BITS;
+    }
+}
+
+/* Returns the number of runs of set bits in C. */
+static uint32_t
+container_run_cnt (const struct container *c)
+{
+  uint32_t runs = 0;
+  uint32_t i;
+
+  switch (c->type)
+    {
+    case CONTAINER_ARRAY:
+      for (i = 0; i < c->cnt; i++)
+        if (i == 0 || c->array[i] != c->array[i - 1] + 1)
+          runs++;
+      return runs;
+
+    case CONTAINER_BITSET:
+      {
+        /* A run starts at each set bit whose predecessor is
+           clear. */
+        uint64_t carry = 0;
+        for (i = 0; i < BITSET_WORDS; i++)
+          {
+            uint64_t w = c->words[i];
+            runs += __builtin_popcountll (w & ~((w << 1) | carry));
+            carry = w >> 63;
+          }
+        return runs;
+      }
+
+    default:
+      return c->cnt;
+    }
+}
+
+/* Converts C to a bitset container.  Like container_reserve(),
+   treats running out of memory as fatal. */
+static void
+to_bitset (struct container *c)
+{
+  uint64_t *words;
+  uint32_t i;
+
+  if (c->type == CONTAINER_BITSET)
+    return;
+  words = calloc (BITSET_WORDS, sizeof *words);
+  if (words == NULL)
+    {
+      fprintf (stderr, "cbitmap: out of memory converting to bitset\n");
+      abort ();
+    }
+  if (c->type == CONTAINER_ARRAY)
+    for (i = 0; i < c->cnt; i++)
+      words[c->array[i] / 64] |= (uint64_t) 1 << (c->array[i] % 64);
+  else
+    for (i = 0; i < c->cnt; i++)
+      words_set_range (words, c->runs[i].start, c->runs[i].last + 1u, true);
+  free (c->array);
+  c->type = CONTAINER_BITSET;
+  c->words = words;
+  c->cnt = 0;
+  c->cap = BITSET_WORDS;
+}
+
+/* Converts C to an array container. */
+static void
+to_array (struct container *c)
+{
+  struct container new = { .type = CONTAINER_ARRAY, .card = c->card };
+  uint32_t i;
+
+  if (c->type == CONTAINER_ARRAY)
+    return;
+  container_reserve (&new, c->card, sizeof *new.array);
+  if (c->type == CONTAINER_BITSET)
+    for (i = 0; i < BITSET_WORDS; i++)
+      {
+        uint64_t bits;
+        for (bits = c->words[i]; bits != 0; bits &= bits - 1)
+          new.array[new.cnt++] = i * 64 + __builtin_ctzll (bits);
+      }
+  else
+    for (i = 0; i < c->cnt; i++)
+      {
+        unsigned ofs;
+        for (ofs = c->runs[i].start; ofs <= c->runs[i].last; ofs++)
+          new.array[new.cnt++] = ofs;
+      }
+  free (c->array);
+  *c = new;
+}
+
+/* Converts C to a run container. */
+static void
+to_runs (struct container *c)
+{
+  struct container new = { .type = CONTAINER_RUN, .card = c->card };
+  unsigned start, end;
+
+  if (c->type == CONTAINER_RUN)
+    return;
+  container_reserve (&new, container_run_cnt (c), sizeof *new.runs);
+  for (end = 0; (start = container_next (c, end, true)) < CHUNK_BITS; )
+    {
+      end = container_next (c, start, false);
+      new.runs[new.cnt].start = start;
+      new.runs[new.cnt].last = end - 1;
+      new.cnt++;
+    }
+  free (c->array);
+  *c = new;
+}
+
+/* Converts C to whichever kind of container stores its contents
+   in the fewest bytes. */
+static void
+container_optimize (struct container *c)
+{
+  size_t run_bytes = container_run_cnt (c) * sizeof (struct run);
+  size_t array_bytes = c->card * sizeof (uint16_t);
+  size_t bitset_bytes = BITSET_WORDS * sizeof (uint64_t);
+
+  if (c->card == 0)
+    container_clear (c);
+  else if (run_bytes <= array_bytes && run_bytes < bitset_bytes)
+    to_runs (c);
+  else if (array_bytes < bitset_bytes)
+    to_array (c);
+  else
+    to_bitset (c);
+}
+
+/* Sets bit OFS in array container C to VALUE, which it must not
+   already have. */
+static void
+array_set (struct container *c, unsigned ofs, bool value)
+{
+  uint32_t i = array_lower_bound (c, ofs);
+
+  if (value)
+    {
+      if (c->cnt == ARRAY_MAX)
+        {
+          to_bitset (c);
+          c->words[ofs / 64] |= (uint64_t) 1 << (ofs % 64);
+          c->card++;
+          return;
+        }
+      container_reserve (c, c->cnt + 1, sizeof *c->array);
+      memmove (c->array + i + 1, c->array + i,
+               (c->cnt - i) * sizeof *c->array);
+      c->array[i] = ofs;
+      c->cnt++;
+    }
+  else
+    {
+      memmove (c->array + i, c->array + i + 1,
+               (c->cnt - i - 1) * sizeof *c->array);
+      c->cnt--;
+    }
+  c->card = c->cnt;
+}
+
+/* Sets bit OFS in bitset container C to VALUE, which it must not
+   already have. */
+static void
+bitset_set (struct container *c, unsigned ofs, bool value)
+{
+  c->words[ofs / 64] ^= (uint64_t) 1 << (ofs % 64);
+  if (value)
+    c->card++;
+  else if (--c->card <= ARRAY_MAX / 2)
+    to_array (c);
+}
+
+/* Inserts the run from START through LAST into run container C
+   as run number I. */
+static void
+run_insert (struct container *c, uint32_t i, unsigned start, unsigned last)
+{
+  container_reserve (c, c->cnt + 1, sizeof *c->runs);
+  memmove (c->runs + i + 1, c->runs + i, (c->cnt - i) * sizeof *c->runs);
+  c->runs[i].start = start;
+  c->runs[i].last = last;
+  c->cnt++;
+}
+
+/* Removes run number I from run container C. */
+static void
+run_remove (struct container *c, uint32_t i)
+{
+  memmove (c->runs + i, c->runs + i + 1, (c->cnt - i - 1) * sizeof *c->runs);
+  c->cnt--;
+}
+
+/* Sets bit OFS in run container C to VALUE, which it must not
+   already have, keeping the runs maximal. */
+static void
+run_set (struct container *c, unsigned ofs, bool value)
+{
+  uint32_t i = run_upper_bound (c, ofs);
+  struct run *prev = i > 0 ? &c->runs[i - 1] : NULL;
+
+  if (value)
+    {
+      bool join_prev = prev != NULL && prev->last + 1u == ofs;
+      bool join_next = i < c->cnt && c->runs[i].start == ofs + 1;
+
+      if (join_prev && join_next)
+        {
+          prev->last = c->runs[i].last;
+          run_remove (c, i);
+        }
+      else if (join_prev)
+        prev->last = ofs;
+      else if (join_next)
+        c->runs[i].start = ofs;
+      else
+        run_insert (c, i, ofs, ofs);
+      c->card++;
+    }
+  else
+    {
+      unsigned last = prev->last;
+
+      if (prev->start == last)
+        run_remove (c, i - 1);
+      else if (prev->start == ofs)
+        prev->start++;
+      else if (last == ofs)
+        prev->last--;
+      else
+        {
+          prev->last = ofs - 1;
+          run_insert (c, i, ofs + 1, last);
+        }
+      c->card--;
+    }
+
+  if (c->cnt > RUN_MAX)
+    {
+      if (c->card <= ARRAY_MAX)
+        to_array (c);
+      else
+        to_bitset (c);
+    }
+}
+
+/* Sets bit OFS in C to VALUE. */
+static void
+container_set (struct container *c, unsigned ofs, bool value)
+{
+  if (container_test (c, ofs) == value)
+    return;
+  switch (c->type)
+    {
+    case CONTAINER_ARRAY:
+      array_set (c, ofs, value);
+      break;
+    case CONTAINER_BITSET:
+      bitset_set (c, ofs, value);
+      break;
+    default:
+      run_set (c, ofs, value);
+      break;
+    }
+  if (c->card == 0)
+    container_clear (c);
+}
+
+/* Sets the bits in C from LO up to but not including HI to
+   VALUE.  The work is done on a bitset, after which C is
+   converted to the smallest kind for its new contents. */
+static void
+container_set_range (struct container *c, unsigned lo, unsigned hi,
+                     bool value)
+{
+  to_bitset (c);
+  words_set_range (c->words, lo, hi, value);
+  c->card = words_count (c->words, 0, CHUNK_BITS);
+  container_optimize (c);
+}
+
+/* Stores the contents of C into the BITSET_WORDS words at
+   WORDS. */
+static void
+container_to_words (const struct container *c, uint64_t *words)
+{
+  uint32_t i;
+
+  memset (words, 0, BITSET_WORDS * sizeof *words);
+  switch (c->type)
+    {
+    case CONTAINER_ARRAY:
+      for (i = 0; i < c->cnt; i++)
+        words[c->array[i] / 64] |= (uint64_t) 1 << (c->array[i] % 64);
+      break;
+    case CONTAINER_BITSET:
+      memcpy (words, c->words, BITSET_WORDS * sizeof *words);
+      break;
+    default:
+      for (i = 0; i < c->cnt; i++)
+        words_set_range (words, c->runs[i].start, c->runs[i].last + 1u,
+                         true);
+      break;
+    }
+}
+
+/* Returns the index of the first bit in B at or after START that
+   is set to VALUE, or B's size if there is none.  Chunks that
+   cannot contain such a bit are skipped by their population. */
+static size_t
+next_value (const struct cbitmap *b, size_t start, bool value)
+{
+  size_t idx;
+
+  for (idx = start / CHUNK_BITS; idx < b->chunk_cnt; idx++)
+    {
+      const struct container *c = &b->chunks[idx];
+      size_t base = idx * CHUNK_BITS;
+      unsigned found;
+
+      if (c->card == (value ? 0 : CHUNK_BITS))
+        continue;
+      found = container_next (c, start > base ? start - base : 0, value);
+      if (found < CHUNK_BITS)
+        return base + found < b->bit_cnt ? base + found : b->bit_cnt;
+    }
+  return b->bit_cnt;
+}
+
+/* Creation and destruction. */
+
+/* Creates and returns a compressed bitmap of BIT_CNT bits, all
+   set to false.  Returns a null pointer if memory allocation
+   failed. */
+struct cbitmap *
+cbitmap_create (size_t bit_cnt)
+{
+  struct cbitmap *b = malloc (sizeof *b);
+  if (b != NULL)
+    {
+      b->bit_cnt = bit_cnt;
+      b->chunk_cnt = chunk_cnt (bit_cnt);
+      b->chunks = calloc (b->chunk_cnt, sizeof *b->chunks);
+      if (b->chunks != NULL || b->chunk_cnt == 0)
+        return b;
+      free (b);
+    }
+  return NULL;
+}
+
+/* Destroys compressed bitmap B, freeing its storage. */
+void
+cbitmap_destroy (struct cbitmap *b)
+{
+  if (b != NULL)
+    {
+      size_t i;
+
+      for (i = 0; i < b->chunk_cnt; i++)
+        free (b->chunks[i].array);
+      free (b->chunks);
+      free (b);
+    }
+}
+
+/* Bitmap size. */
+
+/* Returns the number of bits in B. */
+size_t
+cbitmap_size (const struct cbitmap *b)
+{
+  return b->bit_cnt;
+}
+
+/* Changes the number of bits in B to BIT_CNT.  Bits below both
+   the old and the new size keep their values, and bits added at
+   the end are set to false.  Returns true if successful, false
+   if memory allocation failed, in which case B is unchanged. */
+bool
+cbitmap_resize (struct cbitmap *b, size_t bit_cnt)
+{
+  size_t new_cnt = chunk_cnt (bit_cnt);
+  size_t i;
+
+  if (new_cnt > b->chunk_cnt)
+    {
+      struct container *chunks = realloc (b->chunks,
+                                          new_cnt * sizeof *chunks);
+      if (chunks == NULL)
+        return false;
+      memset (chunks + b->chunk_cnt, 0,
+              (new_cnt - b->chunk_cnt) * sizeof *chunks);
+      b->chunks = chunks;
+    }
+  else
+    {
+      /* Keep the bits past the new end false.  The chunk array
+         is not shrunk, since it is small next to the
+         containers. */
+      if (bit_cnt < b->bit_cnt)
+        cbitmap_set_multiple (b, bit_cnt, b->bit_cnt - bit_cnt, false);
+      for (i = new_cnt; i < b->chunk_cnt; i++)
+        container_clear (&b->chunks[i]);
+    }
+  b->chunk_cnt = new_cnt;
+  b->bit_cnt = bit_cnt;
+  return true;
+}
+
+/* Returns the number of bytes of memory that B occupies. */
+size_t
+cbitmap_memory (const struct cbitmap *b)
+{
+  size_t total = sizeof *b + b->chunk_cnt * sizeof *b->chunks;
+  size_t i;
+
+  for (i = 0; i < b->chunk_cnt; i++)
+    {
+      const struct container *c = &b->chunks[i];
+      switch (c->type)
+        {
+        case CONTAINER_ARRAY:
+          total += c->cap * sizeof *c->array;
+          break;
+        case CONTAINER_BITSET:
+          total += BITSET_WORDS * sizeof *c->words;
+          break;
+        default:
+          total += c->cap * sizeof *c->runs;
+          break;
+        }
+    }
+  return total;
+}
+
+/* Converts every chunk of B to the smallest kind of container for
+   its contents and releases unused capacity.  Single-bit updates
+   only convert containers that outgrow their kind, so this can
+   shrink a bitmap that was built up one bit at a time. */
+void
+cbitmap_optimize (struct cbitmap *b)
+{
+  size_t i;
+
+  for (i = 0; i < b->chunk_cnt; i++)
+    {
+      struct container *c = &b->chunks[i];
+      container_optimize (c);
+      if (c->type != CONTAINER_BITSET && c->cap > c->cnt)
+        {
+          size_t size = (c->type == CONTAINER_ARRAY
+                         ? sizeof *c->array : sizeof *c->runs);
+          void *p = realloc (c->array, c->cnt * size);
+          if (p != NULL)
+            {
+              c->array = p;
+              c->cap = c->cnt;
+            }
+        }
+    }
+}
+
+/* Setting and testing single bits. */
+
+/* Sets the bit numbered IDX in B to VALUE. */
+void
+cbitmap_set (struct cbitmap *b, size_t idx, bool value)
+{
+  ASSERT (b != NULL);
+  ASSERT (idx < b->bit_cnt);
+  container_set (&b->chunks[idx / CHUNK_BITS], idx % CHUNK_BITS, value);
+}
+
+/* Sets the bit numbered IDX in B to true. */
+void
+cbitmap_mark (struct cbitmap *b, size_t idx)
+{
+  cbitmap_set (b, idx, true);
+}
+
+/* Sets the bit numbered IDX in B to false. */
+void
+cbitmap_reset (struct cbitmap *b, size_t idx)
+{
+  cbitmap_set (b, idx, false);
+}
+
+/* Toggles the bit numbered IDX in B;
+   that is, if it is true, makes it false,
+   and if it is false, makes it true. */
+void
+cbitmap_flip (struct cbitmap *b, size_t idx)
+{
+  cbitmap_set (b, idx, !cbitmap_test (b, idx));
+}
+
+/* Returns the value of the bit numbered IDX in B. */
+bool
+cbitmap_test (const struct cbitmap *b, size_t idx)
+{
+  ASSERT (b != NULL);
+  ASSERT (idx < b->bit_cnt);
+  return container_test (&b->chunks[idx / CHUNK_BITS], idx % CHUNK_BITS);
+}
+
+/* Setting and testing multiple bits. */
+
+/* Sets all bits in B to VALUE. */
+void
+cbitmap_set_all (struct cbitmap *b, bool value)
+{
+  ASSERT (b != NULL);
+  cbitmap_set_multiple (b, 0, cbitmap_size (b), value);
+}
+
+/* Sets the CNT bits starting at START in B to VALUE.  Chunks
+   covered entirely become empty or a single run without looking
+   at their old contents. */
+void
+cbitmap_set_multiple (struct cbitmap *b, size_t start, size_t cnt,
+                      bool value)
+{
+  size_t end = start + cnt;
+  size_t idx, next;
+
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+  ASSERT (start + cnt <= b->bit_cnt);
+
+  for (idx = start; idx < end; idx = next)
+    {
+      size_t chunk = idx / CHUNK_BITS;
+      size_t base = chunk * CHUNK_BITS;
+      struct container *c = &b->chunks[chunk];
+      unsigned lo, hi;
+
+      next = base + CHUNK_BITS < end ? base + CHUNK_BITS : end;
+      lo = idx - base;
+      hi = next - base;
+      if (lo == 0 && hi == chunk_size (b, chunk))
+        {
+          if (value)
+            container_fill (c, hi);
+          else
+            container_clear (c);
+        }
+      else if (container_count (c, lo, hi) != (value ? hi - lo : 0))
+        container_set_range (c, lo, hi, value);
+    }
+}
+
+/* Returns the number of bits in B between START and START + CNT,
+   exclusive, that are set to VALUE. */
+size_t
+cbitmap_count (const struct cbitmap *b, size_t start, size_t cnt,
+               bool value)
+{
+  size_t end = start + cnt;
+  size_t idx, next, total;
+
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+  ASSERT (start + cnt <= b->bit_cnt);
+
+  total = 0;
+  for (idx = start; idx < end; idx = next)
+    {
+      size_t chunk = idx / CHUNK_BITS;
+      size_t base = chunk * CHUNK_BITS;
+      const struct container *c = &b->chunks[chunk];
+
+      next = base + CHUNK_BITS < end ? base + CHUNK_BITS : end;
+      if (idx == base && next - base == chunk_size (b, chunk))
+        total += c->card;
+      else
+        total += container_count (c, idx - base, next - base);
+    }
+  return value ? total : cnt - total;
+}
+
+/* Returns true if any bits in B between START and START + CNT,
+   exclusive, are set to VALUE, and false otherwise. */
+bool
+cbitmap_contains (const struct cbitmap *b, size_t start, size_t cnt,
+                  bool value)
+{
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+  ASSERT (start + cnt <= b->bit_cnt);
+
+  return cnt > 0 && next_value (b, start, value) < start + cnt;
+}
+
+/* Returns true if any bits in B between START and START + CNT,
+   exclusive, are set to true, and false otherwise.*/
+bool
+cbitmap_any (const struct cbitmap *b, size_t start, size_t cnt)
+{
+  return cbitmap_contains (b, start, cnt, true);
+}
+
+/* Returns true if no bits in B between START and START + CNT,
+   exclusive, are set to true, and false otherwise.*/
+bool
+cbitmap_none (const struct cbitmap *b, size_t start, size_t cnt)
+{
+  return !cbitmap_contains (b, start, cnt, true);
+}
+
+/* Returns true if every bit in B between START and START + CNT,
+   exclusive, is set to true, and false otherwise. */
+bool
+cbitmap_all (const struct cbitmap *b, size_t start, size_t cnt)
+{
+  return !cbitmap_contains (b, start, cnt, false);
+}
+
+/* Finding set or unset bits. */
+
+/* Finds and returns the starting index of the first group of CNT
+   consecutive bits in B at or after START that are all set to
+   VALUE.
+   If there is no such group, returns BITMAP_ERROR.
+
+   Like bitmap_scan(), this jumps from each run of VALUE bits to
+   the next, but it measures runs with container lookups, so runs
+   and empty or full chunks cost no more than single bits. */
+size_t
+cbitmap_scan (const struct cbitmap *b, size_t start, size_t cnt, bool value)
+{
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+
+  if (cnt == 0)
+    return start;
+  while (start < b->bit_cnt)
+    {
+      size_t first = next_value (b, start, value);
+      if (cnt > b->bit_cnt - first)
+        break;
+      start = next_value (b, first, !value);
+      if (start - first >= cnt)
+        return first;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Finds the first group of CNT consecutive bits in B at or after
+   START that are all set to VALUE, flips them all to !VALUE,
+   and returns the index of the first bit in the group.
+   If there is no such group, returns BITMAP_ERROR. */
+size_t
+cbitmap_scan_and_flip (struct cbitmap *b, size_t start, size_t cnt,
+                       bool value)
+{
+  size_t idx = cbitmap_scan (b, start, cnt, value);
+  if (idx != BITMAP_ERROR)
+    cbitmap_set_multiple (b, idx, cnt, !value);
+  return idx;
+}
+
+/* Iterating over bits. */
+
+/* Returns the index of the first bit in B at or after START that
+   is set to true, or BITMAP_ERROR if there is none. */
+size_t
+cbitmap_next_set (const struct cbitmap *b, size_t start)
+{
+  size_t idx;
+
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+
+  idx = next_value (b, start, true);
+  return idx < b->bit_cnt ? idx : BITMAP_ERROR;
+}
+
+/* Returns the index of the first bit in B at or after START that
+   is set to false, or BITMAP_ERROR if there is none. */
+size_t
+cbitmap_next_clear (const struct cbitmap *b, size_t start)
+{
+  size_t idx;
+
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+
+  idx = next_value (b, start, false);
+  return idx < b->bit_cnt ? idx : BITMAP_ERROR;
+}
+
+/* Debugging. */
+
+/* Dumps the contents of B to the console as hexadecimal, in the
+   same format as bitmap_dump() uses for a struct bitmap with the
+   same bits. */
+void
+cbitmap_dump (const struct cbitmap *b)
+{
+  uint64_t words[BITSET_WORDS];
+  size_t size = DIV_ROUND_UP (b->bit_cnt, 64) * sizeof (uint64_t) / 2;
+  size_t idx;
+
+  for (idx = 0; idx * sizeof words < size; idx++)
+    {
+      size_t ofs = idx * sizeof words;
+      container_to_words (&b->chunks[idx], words);
+      hex_dump (ofs, words, size - ofs < sizeof words ? size - ofs
+                                                      : sizeof words,
+                false);
+    }
+}
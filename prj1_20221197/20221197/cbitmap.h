@@ -0,0 +1,60 @@
+#ifndef __MYLIB_CBITMAP_H
+#define __MYLIB_CBITMAP_H
+
+/* Compressed bitmap.
+
+   An alternative to struct bitmap for bit sets that are mostly
+   empty or that consist of a few long runs.  Its storage is
+   proportional to the contents rather than to the size: a
+   compressed bitmap with no bits set costs a few bytes per 65,536
+   bits, and so does one with all of its bits set.
+
+   The operations mirror those in bitmap.h and have the same
+   semantics, including returning BITMAP_ERROR from failed scans.
+   Unlike struct bitmap, no operation may run concurrently with an
+   update. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "bitmap.h"
+
+/* Creation and destruction. */
+struct cbitmap *cbitmap_create (size_t bit_cnt);
+void cbitmap_destroy (struct cbitmap *);
+
+/* Bitmap size. */
+size_t cbitmap_size (const struct cbitmap *);
+bool cbitmap_resize (struct cbitmap *, size_t bit_cnt);
+size_t cbitmap_memory (const struct cbitmap *);
+void cbitmap_optimize (struct cbitmap *);
+
+/* Setting and testing single bits. */
+void cbitmap_set (struct cbitmap *, size_t idx, bool);
+void cbitmap_mark (struct cbitmap *, size_t idx);
+void cbitmap_reset (struct cbitmap *, size_t idx);
+void cbitmap_flip (struct cbitmap *, size_t idx);
+bool cbitmap_test (const struct cbitmap *, size_t idx);
+
+/* Setting and testing multiple bits. */
+void cbitmap_set_all (struct cbitmap *, bool);
+void cbitmap_set_multiple (struct cbitmap *, size_t start, size_t cnt, bool);
+size_t cbitmap_count (const struct cbitmap *, size_t start, size_t cnt, bool);
+bool cbitmap_contains (const struct cbitmap *, size_t start, size_t cnt,
+                       bool);
+bool cbitmap_any (const struct cbitmap *, size_t start, size_t cnt);
+bool cbitmap_none (const struct cbitmap *, size_t start, size_t cnt);
+bool cbitmap_all (const struct cbitmap *, size_t start, size_t cnt);
+
+/* Finding set or unset bits. */
+size_t cbitmap_scan (const struct cbitmap *, size_t start, size_t cnt, bool);
+size_t cbitmap_scan_and_flip (struct cbitmap *, size_t start, size_t cnt,
+                              bool);
+
+/* Iterating over bits. */
+size_t cbitmap_next_set (const struct cbitmap *, size_t start);
+size_t cbitmap_next_clear (const struct cbitmap *, size_t start);
+
+/* Debugging. */
+void cbitmap_dump (const struct cbitmap *);
+
+#endif /* cbitmap.h */
@@ -0,0 +1,326 @@
+#ifndef __MYLIB_FBITMAP_H
+#define __MYLIB_FBITMAP_H
+
+/* Fixed-size bitmaps.
+
+   BITMAP_DECLARE (NAME, N) declares `struct NAME', a bitmap of
+   exactly N bits that holds its bits inline, so it can live on
+   the stack, in a static variable or inside another structure
+   without any allocation.  It also defines inline functions
+   NAME_set(), NAME_test(), NAME_count(), NAME_scan() and so on,
+   with the same names and semantics as the bitmap.h operations
+   but with the prefix NAME instead of bitmap.  For example:
+
+      BITMAP_DECLARE (cpuset, 256);
+
+      struct cpuset online;
+
+      cpuset_init (&online);
+      cpuset_mark (&online, 3);
+      if (cpuset_any (&online, 0, 64))
+        ...
+
+   A zero-initialized struct NAME has every bit false, just like
+   one passed to NAME_init().
+
+   Because N is a compile-time constant, every size, mask and loop
+   bound in these functions is one too, so the compiler can unroll
+   and vectorize the loops and drop the handling of a partial last
+   element when N is a multiple of the element size.  All of the
+   work is done by the generic fbitmap_*() helpers below, which
+   are always inlined for that reason. */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "bitmap.h"
+
+/* Elements are unsigned long, as inside bitmap.c. */
+#define FBITMAP_ELEM_BITS (sizeof (unsigned long) * CHAR_BIT)
+
+/* Number of elements in a fixed-size bitmap of N bits. */
+#define FBITMAP_ELEMS(N) (((N) + FBITMAP_ELEM_BITS - 1) / FBITMAP_ELEM_BITS)
+
+#define FBITMAP_INLINE static inline __attribute__ ((always_inline))
+
+/* Returns the mask of the bits in element IDX that lie between
+   bits START and END, exclusive, where START < END. */
+FBITMAP_INLINE unsigned long
+fbitmap_range_mask (size_t idx, size_t start, size_t end)
+{
+  unsigned long mask = ~0UL;
+  if (idx == start / FBITMAP_ELEM_BITS)
+    mask &= ~0UL << (start % FBITMAP_ELEM_BITS);
+  if (idx == (end - 1) / FBITMAP_ELEM_BITS && end % FBITMAP_ELEM_BITS != 0)
+    mask &= (1UL << (end % FBITMAP_ELEM_BITS)) - 1;
+  return mask;
+}
+
+/* Sets bit IDX of the N-bit bitmap BITS to VALUE. */
+FBITMAP_INLINE void
+fbitmap_set (unsigned long *bits, size_t n, size_t idx, bool value)
+{
+  unsigned long mask = 1UL << (idx % FBITMAP_ELEM_BITS);
+
+  assert (idx < n);
+  if (value)
+    bits[idx / FBITMAP_ELEM_BITS] |= mask;
+  else
+    bits[idx / FBITMAP_ELEM_BITS] &= ~mask;
+}
+
+/* Toggles bit IDX of the N-bit bitmap BITS. */
+FBITMAP_INLINE void
+fbitmap_flip (unsigned long *bits, size_t n, size_t idx)
+{
+  assert (idx < n);
+  bits[idx / FBITMAP_ELEM_BITS] ^= 1UL << (idx % FBITMAP_ELEM_BITS);
+}
+
+/* Returns the value of bit IDX of the N-bit bitmap BITS. */
+FBITMAP_INLINE bool
+fbitmap_test (const unsigned long *bits, size_t n, size_t idx)
+{
+  assert (idx < n);
+  return (bits[idx / FBITMAP_ELEM_BITS] >> (idx % FBITMAP_ELEM_BITS)) & 1;
+}
+
+/* Sets every bit of the N-bit bitmap BITS to VALUE, keeping the
+   unused bits of the last element false. */
+FBITMAP_INLINE void
+fbitmap_set_all (unsigned long *bits, size_t n, bool value)
+{
+  size_t i;
+
+  for (i = 0; i < FBITMAP_ELEMS (n); i++)
+    bits[i] = value ? ~0UL : 0;
+  if (value && n % FBITMAP_ELEM_BITS != 0)
+    bits[FBITMAP_ELEMS (n) - 1] = (1UL << (n % FBITMAP_ELEM_BITS)) - 1;
+}
+
+/* Sets the CNT bits starting at START in the N-bit bitmap BITS
+   to VALUE. */
+FBITMAP_INLINE void
+fbitmap_set_multiple (unsigned long *bits, size_t n, size_t start,
+                      size_t cnt, bool value)
+{
+  size_t end = start + cnt;
+  size_t i;
+
+  assert (start <= n && end <= n);
+  if (cnt == 0)
+    return;
+  for (i = start / FBITMAP_ELEM_BITS; i <= (end - 1) / FBITMAP_ELEM_BITS; i++)
+    {
+      unsigned long mask = fbitmap_range_mask (i, start, end);
+      if (value)
+        bits[i] |= mask;
+      else
+        bits[i] &= ~mask;
+    }
+}
+
+/* Returns the number of bits set to VALUE among the CNT bits
+   starting at START in the N-bit bitmap BITS. */
+FBITMAP_INLINE size_t
+fbitmap_count (const unsigned long *bits, size_t n, size_t start,
+               size_t cnt, bool value)
+{
+  size_t end = start + cnt;
+  size_t total = 0;
+  size_t i;
+
+  assert (start <= n && end <= n);
+  if (cnt == 0)
+    return 0;
+  for (i = start / FBITMAP_ELEM_BITS; i <= (end - 1) / FBITMAP_ELEM_BITS; i++)
+    total += __builtin_popcountl (bits[i] & fbitmap_range_mask (i, start, end));
+  return value ? total : cnt - total;
+}
+
+/* Returns true if any of the CNT bits starting at START in the
+   N-bit bitmap BITS is set to VALUE. */
+FBITMAP_INLINE bool
+fbitmap_contains (const unsigned long *bits, size_t n, size_t start,
+                  size_t cnt, bool value)
+{
+  size_t end = start + cnt;
+  size_t i;
+
+  assert (start <= n && end <= n);
+  if (cnt == 0)
+    return false;
+  for (i = start / FBITMAP_ELEM_BITS; i <= (end - 1) / FBITMAP_ELEM_BITS; i++)
+    if (((value ? bits[i] : ~bits[i]) & fbitmap_range_mask (i, start, end))
+        != 0)
+      return true;
+  return false;
+}
+
+/* Returns the index of the first bit at or after START and before
+   END in the bitmap BITS that is set to VALUE, or END if there is
+   none. */
+FBITMAP_INLINE size_t
+fbitmap_find (const unsigned long *bits, size_t start, size_t end,
+              bool value)
+{
+  size_t i;
+
+  if (start >= end)
+    return end;
+  for (i = start / FBITMAP_ELEM_BITS; i <= (end - 1) / FBITMAP_ELEM_BITS; i++)
+    {
+      unsigned long e = ((value ? bits[i] : ~bits[i])
+                         & fbitmap_range_mask (i, start, end));
+      if (e != 0)
+        return i * FBITMAP_ELEM_BITS + __builtin_ctzl (e);
+    }
+  return end;
+}
+
+/* Returns the index of the first group of CNT consecutive bits at
+   or after START in the N-bit bitmap BITS that are all set to
+   VALUE, or BITMAP_ERROR if there is none.  Jumps over runs that
+   are too short, as bitmap_scan() does. */
+FBITMAP_INLINE size_t
+fbitmap_scan (const unsigned long *bits, size_t n, size_t start, size_t cnt,
+              bool value)
+{
+  size_t i, last;
+
+  assert (start <= n);
+  if (cnt > n)
+    return BITMAP_ERROR;
+  last = n - cnt;
+  if (cnt == 0)
+    return start <= last ? start : BITMAP_ERROR;
+  for (i = start; i <= last; )
+    {
+      size_t run_end;
+
+      i = fbitmap_find (bits, i, last + 1, value);
+      if (i > last)
+        break;
+      run_end = fbitmap_find (bits, i, i + cnt, !value);
+      if (run_end == i + cnt)
+        return i;
+      i = run_end + 1;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Declares struct NAME, a bitmap of N bits, and the operations on
+   it.  See the comment at the top of this file. */
+#define BITMAP_DECLARE(NAME, N)                                         \
+  struct NAME                                                           \
+    {                                                                   \
+      unsigned long bits[FBITMAP_ELEMS (N)];                            \
+    };                                                                  \
+                                                                        \
+  FBITMAP_INLINE void                                                   \
+  NAME##_init (struct NAME *b)                                          \
+  {                                                                     \
+    fbitmap_set_all (b->bits, N, false);                                \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE size_t                                                 \
+  NAME##_size (const struct NAME *b)                                    \
+  {                                                                     \
+    (void) b;                                                           \
+    return N;                                                           \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE void                                                   \
+  NAME##_set (struct NAME *b, size_t idx, bool value)                   \
+  {                                                                     \
+    fbitmap_set (b->bits, N, idx, value);                               \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE void                                                   \
+  NAME##_mark (struct NAME *b, size_t idx)                              \
+  {                                                                     \
+    fbitmap_set (b->bits, N, idx, true);                                \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE void                                                   \
+  NAME##_reset (struct NAME *b, size_t idx)                             \
+  {                                                                     \
+    fbitmap_set (b->bits, N, idx, false);                               \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE void                                                   \
+  NAME##_flip (struct NAME *b, size_t idx)                              \
+  {                                                                     \
+    fbitmap_flip (b->bits, N, idx);                                     \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE bool                                                   \
+  NAME##_test (const struct NAME *b, size_t idx)                        \
+  {                                                                     \
+    return fbitmap_test (b->bits, N, idx);                              \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE void                                                   \
+  NAME##_set_all (struct NAME *b, bool value)                           \
+  {                                                                     \
+    fbitmap_set_all (b->bits, N, value);                                \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE void                                                   \
+  NAME##_set_multiple (struct NAME *b, size_t start, size_t cnt,        \
+                       bool value)                                      \
+  {                                                                     \
+    fbitmap_set_multiple (b->bits, N, start, cnt, value);               \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE size_t                                                 \
+  NAME##_count (const struct NAME *b, size_t start, size_t cnt,         \
+                bool value)                                             \
+  {                                                                     \
+    return fbitmap_count (b->bits, N, start, cnt, value);               \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE bool                                                   \
+  NAME##_contains (const struct NAME *b, size_t start, size_t cnt,      \
+                   bool value)                                          \
+  {                                                                     \
+    return fbitmap_contains (b->bits, N, start, cnt, value);            \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE bool                                                   \
+  NAME##_any (const struct NAME *b, size_t start, size_t cnt)           \
+  {                                                                     \
+    return fbitmap_contains (b->bits, N, start, cnt, true);             \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE bool                                                   \
+  NAME##_none (const struct NAME *b, size_t start, size_t cnt)          \
+  {                                                                     \
+    return !fbitmap_contains (b->bits, N, start, cnt, true);            \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE bool                                                   \
+  NAME##_all (const struct NAME *b, size_t start, size_t cnt)           \
+  {                                                                     \
+    return !fbitmap_contains (b->bits, N, start, cnt, false);           \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE size_t                                                 \
+  NAME##_scan (const struct NAME *b, size_t start, size_t cnt,          \
+               bool value)                                              \
+  {                                                                     \
+    return fbitmap_scan (b->bits, N, start, cnt, value);                \
+  }                                                                     \
+                                                                        \
+  FBITMAP_INLINE size_t                                                 \
+  NAME##_scan_and_flip (struct NAME *b, size_t start, size_t cnt,       \
+                        bool value)                                     \
+  {                                                                     \
+    size_t idx = fbitmap_scan (b->bits, N, start, cnt, value);          \
+    if (idx != BITMAP_ERROR)                                            \
+      fbitmap_set_multiple (b->bits, N, idx, cnt, !value);              \
+    return idx;                                                         \
+  }
+
+#endif /* fbitmap.h */
@@ -4,33 +4,111 @@ See hash.h for basic information. */
 
 #include "hash.h"
 #include <assert.h>	
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>	
+#include <string.h>
+#include "simd.h"
 
 #define ASSERT(CONDITION) assert(CONDITION)	
 
 #define list_elem_to_hash_elem(LIST_ELEM)                       \
         list_entry(LIST_ELEM, struct hash_elem, list_elem)
 
+/* Control bytes of a HASH_OPEN table.  A slot that holds an
+   element has the low 7 bits of the element's hash value as its
+   control byte, so any control byte below CTRL_EMPTY means the
+   slot is full. */
+#define CTRL_EMPTY 0x80         /* Never used since the last rehash. */
+#define CTRL_DELETED 0xfe       /* Held an element that was deleted. */
+
 static struct list *find_bucket (struct hash *, struct hash_elem *);
 static struct hash_elem *find_elem (struct hash *, struct list *,
-                                    struct hash_elem *);
+                                    struct hash_elem *, unsigned hash);
+static struct hash_elem *lookup (struct hash *, struct hash_elem *,
+                                 unsigned hash, struct list **);
+static struct list *bucket_at (struct hash *, size_t idx);
 static void insert_elem (struct hash *, struct list *, struct hash_elem *);
 static void remove_elem (struct hash *, struct hash_elem *);
+static size_t ideal_bucket_cnt (size_t cnt);
+static bool resize (struct hash *, size_t new_bucket_cnt);
+static void migrate (struct hash *, size_t cnt);
 static void rehash (struct hash *);
+static void drop_old (struct hash *);
+static unsigned table_hash (struct hash *, struct hash_elem *);
+static unsigned elem_hash (struct hash *, struct hash_elem *);
+static struct hash_elem **slot_at (struct hash *, size_t idx);
+
+static struct hash_elem **compact_lookup (struct hash *, struct hash_elem *,
+                                          unsigned hash);
+static void compact_push (struct hash *, struct hash_elem *, unsigned hash);
+
+static bool open_alloc (struct hash *, size_t slot_cnt);
+static unsigned char *open_ctrl (struct hash *, size_t idx);
+static size_t open_find (struct hash *, struct hash_elem *, unsigned hash);
+static void open_insert (struct hash *, struct hash_elem *, unsigned hash);
+static void open_remove (struct hash *, size_t idx);
+static size_t open_slot_cnt (size_t cnt);
+static void open_migrate (struct hash *, size_t cnt);
+static bool open_rehash (struct hash *, size_t need_cnt);
+
+/* Returns where H keeps the cached hash value of E.  The list
+   element of a HASH_CHAINED table fills struct hash_elem, so E
+   must be the ELEM member of a struct hash_cached_elem, while
+   the other engines have room for the value in E itself. */
+static inline unsigned *
+cached_hash (struct hash *h, struct hash_elem *e)
+{
+  if (h->engine == HASH_CHAINED)
+    return &((struct hash_cached_elem *) e)->hash;
+  return &e->hash;
+}
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
 bool
 hash_init (struct hash *h,
            hash_hash_func *hash, hash_less_func *less, void *aux) 
+{
+  return hash_init_engine (h, HASH_CHAINED, hash, less, aux);
+}
+
+/* Like hash_init(), but stores the table's elements using
+   ENGINE.  Apart from the order of iteration, the choice is
+   invisible to the users of the table. */
+bool
+hash_init_engine (struct hash *h, enum hash_engine engine,
+                  hash_hash_func *hash, hash_less_func *less, void *aux)
 {
   h->elem_cnt = 0;
-  h->bucket_cnt = 4;
-  h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
   h->hash = hash;
   h->less = less;
+  h->eq = NULL;
   h->aux = aux;
+  h->engine = engine;
+  h->buckets = NULL;
+  h->ctrl = NULL;
+  h->slots = NULL;
+  h->tomb_cnt = 0;
+  h->reserve_cnt = 0;
+  h->cache_hashes = engine == HASH_COMPACT;
+  h->seed = 0;
+  h->old_bucket_cnt = 0;
+  h->migrate_idx = 0;
+  h->old_buckets = NULL;
+  h->old_ctrl = NULL;
+  h->old_slots = NULL;
+
+  if (engine == HASH_OPEN)
+    return open_alloc (h, SIMD_GROUP);
 
+  h->bucket_cnt = 4;
+  if (engine == HASH_COMPACT)
+    {
+      h->slots = calloc (h->bucket_cnt, sizeof *h->slots);
+      return h->slots != NULL;
+    }
+  h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
   if (h->buckets != NULL) 
     {
       hash_clear (h, NULL);
@@ -40,6 +118,62 @@ hash_init (struct hash *h,
     return false;
 }
 
+/* Makes H store each element's hash value with its struct
+   hash_elem if CACHE is true, or stop doing so if it is false.
+   H must be empty.  While a HASH_CHAINED table caches, every
+   element inserted into it must be the ELEM member of a struct
+   hash_cached_elem.  A HASH_OPEN table keeps the value in the
+   struct hash_elem, which it does not otherwise use, and a
+   HASH_COMPACT table always caches, since its chain link leaves
+   room for the value anyway.
+
+   With cached hash values, resizing H never calls the hash
+   function, and lookups only call the comparison function for
+   elements whose full hash value matches, which avoids most of
+   the calls on a failed lookup.  In exchange, an element's key
+   must not change while it is in H, even through hash_apply(),
+   since its hash value would no longer match it. */
+void
+hash_cache_hashes (struct hash *h, bool cache)
+{
+  ASSERT (hash_empty (h));
+  h->cache_hashes = cache || h->engine == HASH_COMPACT;
+}
+
+/* Makes H compare elements for equality by calling EQ, which
+   answers with one call what otherwise takes two calls to the
+   less function.  H must be empty.  A null EQ goes back to using
+   the less function, which the table never needs otherwise, so
+   a table with an equality function may be initialized with a
+   null LESS. */
+void
+hash_set_eq (struct hash *h, hash_eq_func *eq)
+{
+  ASSERT (hash_empty (h));
+  ASSERT (eq != NULL || h->less != NULL);
+  h->eq = eq;
+}
+
+/* Makes H mix SEED into every hash value that its hash function
+   returns, before using it to pick a bucket or slot.  H must be
+   empty.  A seed of 0, the default, leaves the hash values
+   unchanged.
+
+   The mixing spreads every bit of the hash value into the bits
+   that select a bucket, so that a weak hash function whose low
+   bits vary little still fills the table evenly, and a random
+   seed keeps anyone who does not know it from choosing keys
+   that land in the same bucket.  It cannot separate keys whose
+   hash values are equal, though.  To defend against those too,
+   use one of the seeded hash functions below with a secret seed
+   in the hash function itself. */
+void
+hash_set_seed (struct hash *h, uint64_t seed)
+{
+  ASSERT (hash_empty (h));
+  h->seed = seed;
+}
+
 /* Removes all the elements from H.
    
    If DESTRUCTOR is non-null, then it is called for each element
@@ -54,9 +188,41 @@ hash_clear (struct hash *h, hash_action_func *destructor)
 {
   size_t i;
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  if (h->engine == HASH_OPEN)
     {
-      struct list *bucket = &h->buckets[i];
+      if (destructor != NULL)
+        for (i = 0; i < h->bucket_cnt + h->old_bucket_cnt; i++)
+          if (*open_ctrl (h, i) < CTRL_EMPTY)
+            destructor (*slot_at (h, i), h->aux);
+      drop_old (h);
+      memset (h->ctrl, CTRL_EMPTY, h->bucket_cnt);
+      h->elem_cnt = 0;
+      h->tomb_cnt = 0;
+      return;
+    }
+
+  if (h->engine == HASH_COMPACT)
+    {
+      if (destructor != NULL)
+        for (i = 0; i < h->bucket_cnt + h->old_bucket_cnt; i++)
+          {
+            struct hash_elem *e, *next;
+
+            for (e = *slot_at (h, i); e != NULL; e = next)
+              {
+                next = e->next;
+                destructor (e, h->aux);
+              }
+          }
+      drop_old (h);
+      memset (h->slots, 0, sizeof *h->slots * h->bucket_cnt);
+      h->elem_cnt = 0;
+      return;
+    }
+
+  for (i = 0; i < h->bucket_cnt + h->old_bucket_cnt; i++) 
+    {
+      struct list *bucket = bucket_at (h, i);
 
       if (destructor != NULL) 
         while (!list_empty (bucket)) 
@@ -69,6 +235,7 @@ hash_clear (struct hash *h, hash_action_func *destructor)
       list_init (bucket); 
     }    
 
+  drop_old (h);
   h->elem_cnt = 0;
 }
 
@@ -87,7 +254,64 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
 {
   if (destructor != NULL)
     hash_clear (h, destructor);
+  drop_old (h);
   free (h->buckets);
+  free (h->ctrl);
+  free (h->slots);
+}
+
+/* Completes any rehash of H that is in progress. */
+static void
+finish_rehash (struct hash *h)
+{
+  if (h->engine == HASH_OPEN)
+    open_migrate (h, SIZE_MAX);
+  else
+    migrate (h, SIZE_MAX);
+}
+
+/* Makes room in H for CNT elements in total, so that inserting
+   elements until H holds CNT of them does not resize it, and
+   keeps H from shrinking below that size until
+   hash_shrink_to_fit() is called.  Unlike the resizing done by
+   insertions and deletions, this moves all of the elements at
+   once.  Returns true if successful, false if memory allocation
+   failed, in which case H is usable but still not resized. */
+bool
+hash_reserve (struct hash *h, size_t cnt)
+{
+  bool ok = true;
+
+  h->reserve_cnt = cnt;
+  finish_rehash (h);
+  if (h->engine == HASH_OPEN)
+    {
+      if (open_slot_cnt (cnt) > h->bucket_cnt)
+        ok = open_rehash (h, cnt);
+    }
+  else if (ideal_bucket_cnt (cnt) > h->bucket_cnt)
+    ok = resize (h, ideal_bucket_cnt (cnt));
+  finish_rehash (h);
+  return ok;
+}
+
+/* Cancels any earlier hash_reserve() on H and shrinks H to the
+   size that suits the number of elements it holds now, moving
+   all of them at once.  Does nothing if memory allocation
+   fails. */
+void
+hash_shrink_to_fit (struct hash *h)
+{
+  h->reserve_cnt = 0;
+  finish_rehash (h);
+  if (h->engine == HASH_OPEN)
+    {
+      if (open_slot_cnt (h->elem_cnt) < h->bucket_cnt || h->tomb_cnt != 0)
+        open_rehash (h, h->elem_cnt);
+    }
+  else if (ideal_bucket_cnt (h->elem_cnt) < h->bucket_cnt)
+    resize (h, ideal_bucket_cnt (h->elem_cnt));
+  finish_rehash (h);
 }
 
 /* Inserts NEW into hash table H and returns a null pointer, if
@@ -97,13 +321,38 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
 struct hash_elem *
 hash_insert (struct hash *h, struct hash_elem *new)
 {
-  struct list *bucket = find_bucket (h, new);
-  struct hash_elem *old = find_elem (h, bucket, new);
+  unsigned hash = table_hash (h, new);
+  struct list *bucket;
+  struct hash_elem *old;
 
-  if (old == NULL) 
-    insert_elem (h, bucket, new);
+  if (h->cache_hashes)
+    *cached_hash (h, new) = hash;
+  if (h->engine == HASH_OPEN)
+    {
+      size_t slot = open_find (h, new, hash);
+      if (slot != SIZE_MAX)
+        return *slot_at (h, slot);
+      open_insert (h, new, hash);
+      return NULL;
+    }
+  if (h->engine == HASH_COMPACT)
+    {
+      struct hash_elem **link = compact_lookup (h, new, hash);
+      if (link != NULL)
+        return *link;
+      compact_push (h, new, hash);
+      h->elem_cnt++;
+      rehash (h);
+      return NULL;
+    }
 
-  rehash (h);
+  old = lookup (h, new, hash, &bucket);
+
+  if (old == NULL) 
+    {
+      insert_elem (h, bucket, new);
+      rehash (h);
+    }
 
   return old; 
 }
@@ -113,8 +362,41 @@ hash_insert (struct hash *h, struct hash_elem *new)
 struct hash_elem *
 hash_replace (struct hash *h, struct hash_elem *new) 
 {
-  struct list *bucket = find_bucket (h, new);
-  struct hash_elem *old = find_elem (h, bucket, new);
+  unsigned hash = table_hash (h, new);
+  struct list *bucket;
+  struct hash_elem *old;
+
+  if (h->cache_hashes)
+    *cached_hash (h, new) = hash;
+  if (h->engine == HASH_OPEN)
+    {
+      size_t slot = open_find (h, new, hash);
+      if (slot == SIZE_MAX)
+        {
+          open_insert (h, new, hash);
+          return NULL;
+        }
+      old = *slot_at (h, slot);
+      *slot_at (h, slot) = new;
+      return old;
+    }
+  if (h->engine == HASH_COMPACT)
+    {
+      struct hash_elem **link = compact_lookup (h, new, hash);
+      if (link == NULL)
+        {
+          compact_push (h, new, hash);
+          h->elem_cnt++;
+          rehash (h);
+          return NULL;
+        }
+      old = *link;
+      new->next = old->next;
+      *link = new;
+      return old;
+    }
+
+  old = lookup (h, new, hash, &bucket);
 
   if (old != NULL)
     remove_elem (h, old);
@@ -125,12 +407,52 @@ hash_replace (struct hash *h, struct hash_elem *new)
   return old;
 }
 
+/* Returns the element of H equal to NEW if there is one, and
+   otherwise inserts NEW into H and returns NEW.  Either way this
+   hashes NEW and searches H only once, unlike hash_find()
+   followed by hash_insert().  The caller can tell whether NEW was
+   inserted by comparing the result with NEW. */
+struct hash_elem *
+hash_find_or_insert (struct hash *h, struct hash_elem *new)
+{
+  struct hash_elem *old = hash_insert (h, new);
+  return old != NULL ? old : new;
+}
+
+/* Like hash_find_or_insert(), but if H already has an element
+   equal to NEW, calls UPDATE on that element before returning
+   it, and NEW is not inserted.  UPDATE must not change the
+   element in a way that affects its hash value or how it
+   compares with other elements. */
+struct hash_elem *
+hash_upsert (struct hash *h, struct hash_elem *new, hash_action_func *update)
+{
+  struct hash_elem *old = hash_insert (h, new);
+
+  if (old == NULL)
+    return new;
+  update (old, h->aux);
+  return old;
+}
+
 /* Finds and returns an element equal to E in hash table H, or a
    null pointer if no equal element exists in the table. */
 struct hash_elem *
 hash_find (struct hash *h, struct hash_elem *e) 
 {
-  return find_elem (h, find_bucket (h, e), e);
+  unsigned hash = table_hash (h, e);
+
+  if (h->engine == HASH_OPEN)
+    {
+      size_t slot = open_find (h, e, hash);
+      return slot != SIZE_MAX ? *slot_at (h, slot) : NULL;
+    }
+  if (h->engine == HASH_COMPACT)
+    {
+      struct hash_elem **link = compact_lookup (h, e, hash);
+      return link != NULL ? *link : NULL;
+    }
+  return lookup (h, e, hash, NULL);
 }
 
 /* Finds, removes, and returns an element equal to E in hash
@@ -143,7 +465,31 @@ hash_find (struct hash *h, struct hash_elem *e)
 struct hash_elem *
 hash_delete (struct hash *h, struct hash_elem *e)
 {
-  struct hash_elem *found = find_elem (h, find_bucket (h, e), e);
+  unsigned hash = table_hash (h, e);
+  struct hash_elem *found;
+
+  if (h->engine == HASH_OPEN)
+    {
+      size_t slot = open_find (h, e, hash);
+      if (slot == SIZE_MAX)
+        return NULL;
+      found = *slot_at (h, slot);
+      open_remove (h, slot);
+      return found;
+    }
+  if (h->engine == HASH_COMPACT)
+    {
+      struct hash_elem **link = compact_lookup (h, e, hash);
+      if (link == NULL)
+        return NULL;
+      found = *link;
+      *link = found->next;
+      h->elem_cnt--;
+      rehash (h);
+      return found;
+    }
+
+  found = lookup (h, e, hash, NULL);
   if (found != NULL) 
     {
       remove_elem (h, found);
@@ -165,9 +511,31 @@ hash_apply (struct hash *h, hash_action_func *action)
   
   ASSERT (action != NULL);
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  if (h->engine == HASH_OPEN)
     {
-      struct list *bucket = &h->buckets[i];
+      for (i = 0; i < h->bucket_cnt + h->old_bucket_cnt; i++)
+        if (*open_ctrl (h, i) < CTRL_EMPTY)
+          action (*slot_at (h, i), h->aux);
+      return;
+    }
+  if (h->engine == HASH_COMPACT)
+    {
+      for (i = 0; i < h->bucket_cnt + h->old_bucket_cnt; i++)
+        {
+          struct hash_elem *e, *next;
+
+          for (e = *slot_at (h, i); e != NULL; e = next)
+            {
+              next = e->next;
+              action (e, h->aux);
+            }
+        }
+      return;
+    }
+
+  for (i = 0; i < h->bucket_cnt + h->old_bucket_cnt; i++) 
+    {
+      struct list *bucket = bucket_at (h, i);
       struct list_elem *elem, *next;
 
       for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) 
@@ -202,7 +570,15 @@ hash_first (struct hash_iterator *i, struct hash *h)
   ASSERT (h != NULL);
 
   i->hash = h;
-  i->bucket = i->hash->buckets;
+  if (h->engine != HASH_CHAINED)
+    {
+      i->bucket = NULL;
+      i->elem = NULL;
+      i->slot = SIZE_MAX;
+      return;
+    }
+  i->slot = 0;
+  i->bucket = bucket_at (h, 0);
   i->elem = list_elem_to_hash_elem (list_head (i->bucket));
 }
 
@@ -219,14 +595,38 @@ hash_next (struct hash_iterator *i)
 {
   ASSERT (i != NULL);
 
+  if (i->hash->engine == HASH_OPEN)
+    {
+      struct hash *h = i->hash;
+
+      /* SLOT wraps around from SIZE_MAX to 0 on the first call. */
+      while (++i->slot < h->bucket_cnt + h->old_bucket_cnt)
+        if (*open_ctrl (h, i->slot) < CTRL_EMPTY)
+          return i->elem = *slot_at (h, i->slot);
+      return i->elem = NULL;
+    }
+  if (i->hash->engine == HASH_COMPACT)
+    {
+      struct hash *h = i->hash;
+
+      if (i->elem != NULL && i->elem->next != NULL)
+        return i->elem = i->elem->next;
+      /* SLOT wraps around from SIZE_MAX to 0 on the first call. */
+      while (++i->slot < h->bucket_cnt + h->old_bucket_cnt)
+        if (*slot_at (h, i->slot) != NULL)
+          return i->elem = *slot_at (h, i->slot);
+      return i->elem = NULL;
+    }
+
   i->elem = list_elem_to_hash_elem (list_next (&i->elem->list_elem));
   while (i->elem == list_elem_to_hash_elem (list_end (i->bucket)))
     {
-      if (++i->bucket >= i->hash->buckets + i->hash->bucket_cnt)
+      if (++i->slot >= i->hash->bucket_cnt + i->hash->old_bucket_cnt)
         {
           i->elem = NULL;
           break;
         }
+      i->bucket = bucket_at (i->hash, i->slot);
       i->elem = list_elem_to_hash_elem (list_begin (i->bucket));
     }
   
@@ -256,6 +656,90 @@ hash_empty (struct hash *h)
   return h->elem_cnt == 0;
 }
 
+/* Adds a chain of LEN elements, or an element found after
+   examining LEN groups, to the statistics in ST. */
+static void
+stats_add (struct hash_stats *st, size_t len, size_t weight)
+{
+  st->histogram[len < HASH_STATS_HIST ? len : HASH_STATS_HIST - 1] += weight;
+  if (len > st->max_len)
+    st->max_len = len;
+}
+
+/* Returns the number of groups that a lookup for an element with
+   hash value HASH examines in an open table of SLOT_CNT slots
+   before reaching the element in slot SLOT. */
+static size_t
+open_probe_len (size_t slot_cnt, unsigned hash, size_t slot)
+{
+  size_t group_cnt = slot_cnt / SIMD_GROUP;
+  size_t group = (hash >> 7) & (group_cnt - 1);
+  size_t i;
+
+  for (i = 0; group != slot / SIMD_GROUP; i++)
+    group = (group + i + 1) & (group_cnt - 1);
+  return i + 1;
+}
+
+/* Fills in ST with statistics about how the elements of H are
+   spread over its buckets or slots, counting the old ones of a
+   rehash in progress too.  Meant for choosing a hash function,
+   so it calls H's hash function for every element of an open
+   table that does not cache hash values.
+
+   For the chained engines, HISTOGRAM[I] is the number of chains
+   of length I, MAX_LEN is the longest chain, and AVG_PROBE is
+   the average number of elements a successful lookup compares
+   against.  For HASH_OPEN, HISTOGRAM[I] is the number of
+   elements that a lookup finds in the Ith group that it
+   examines, MAX_LEN is the most groups examined, and AVG_PROBE
+   is their average.  Either way, the last entry of HISTOGRAM
+   also counts everything beyond it. */
+void
+hash_get_stats (struct hash *h, struct hash_stats *st)
+{
+  size_t probe_sum = 0;
+  size_t i;
+
+  memset (st, 0, sizeof *st);
+  st->bucket_cnt = h->bucket_cnt + h->old_bucket_cnt;
+  for (i = 0; i < st->bucket_cnt; i++)
+    {
+      size_t len = 0;
+
+      if (h->engine == HASH_OPEN)
+        {
+          bool old = i >= h->bucket_cnt;
+          size_t slot = old ? i - h->bucket_cnt : i;
+
+          if (*open_ctrl (h, i) >= CTRL_EMPTY)
+            {
+              st->empty_cnt++;
+              continue;
+            }
+          len = open_probe_len (old ? h->old_bucket_cnt : h->bucket_cnt,
+                                elem_hash (h, *slot_at (h, i)), slot);
+          stats_add (st, len, 1);
+          probe_sum += len;
+          continue;
+        }
+
+      if (h->engine == HASH_COMPACT)
+        {
+          struct hash_elem *e;
+          for (e = *slot_at (h, i); e != NULL; e = e->next)
+            len++;
+        }
+      else
+        len = list_size (bucket_at (h, i));
+      if (len == 0)
+        st->empty_cnt++;
+      stats_add (st, len, 1);
+      probe_sum += len * (len + 1) / 2;
+    }
+  st->avg_probe = h->elem_cnt != 0 ? (double) probe_sum / h->elem_cnt : 0;
+}
+
 /* Fowler-Noll-Vo hash constants, for 32-bit word sizes. */
 #define FNV_32_PRIME 16777619u
 #define FNV_32_BASIS 2166136261u
@@ -265,16 +749,9 @@ unsigned
 hash_bytes (const void *buf_, size_t size)
 {
   /* Fowler-Noll-Vo 32-bit hash, for bytes. */
-  const unsigned char *buf = buf_;
-  unsigned hash;
-
-  ASSERT (buf != NULL);
+  ASSERT (buf_ != NULL);
 
-  hash = FNV_32_BASIS;
-  while (size-- > 0)
-    hash = (hash * FNV_32_PRIME) ^ *buf++;
-
-  return hash;
+  return simd_fnv1 (buf_, size, FNV_32_BASIS, FNV_32_PRIME);
 } 
 
 /* Returns a hash of string S. */
@@ -293,37 +770,279 @@ hash_string (const char *s_)
   return hash;
 }
 
-/* Returns a hash of integer I. */
+/* Returns a hash of integer I.  This is hash_int_seed() with a
+   seed of 0, so every bit of I affects every bit of the result
+   and consecutive or evenly spaced integers spread over all the
+   buckets of a table. */
 unsigned
 hash_int (int i) 
+{
+  return hash_int_seed (i, 0);
+}
+
+/* Returns the FNV-1 hash of the bytes of integer I, which is what
+   hash_int() used to return.  Its low bits depend mostly on the
+   last byte of I, so integers that differ only in their high
+   bytes tend to share buckets. */
+unsigned
+hash_int_fnv (int i)
 {
   return hash_bytes (&i, sizeof i);
 }
 
-/* Returns the bucket in H that E belongs in. */
+/* Multipliers for the seeded hash functions: odd 64-bit
+   constants with well-mixed bits, from xxHash. */
+#define PRIME64_1 0x9e3779b185ebca87ull
+#define PRIME64_2 0xc2b2ae3d27d4eb4full
+
+/* Returns X rotated left by R bits, 0 < R < 64. */
+static inline uint64_t
+rotl64 (uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+/* Returns X with every bit mixed into every other bit.  This is
+   the MurmurHash3 finalizer, which is a bijection. */
+static inline uint64_t
+mix64 (uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+/* Returns a hash of the SIZE bytes in BUF, which depends on
+   SEED.  The bytes are consumed eight at a time, so this is much
+   faster than hash_bytes() for all but the shortest inputs. */
+unsigned
+hash_bytes_seed (const void *buf_, size_t size, uint64_t seed)
+{
+  const unsigned char *buf = buf_;
+  uint64_t hash = seed + size * PRIME64_2;
+  uint64_t word;
+
+  ASSERT (buf != NULL || size == 0);
+
+  for (; size >= 8; size -= 8, buf += 8)
+    {
+      memcpy (&word, buf, sizeof word);
+      hash = rotl64 (hash ^ word * PRIME64_2, 31) * PRIME64_1;
+    }
+  if (size > 0)
+    {
+      word = 0;
+      memcpy (&word, buf, size);
+      hash = rotl64 (hash ^ word * PRIME64_2, 31) * PRIME64_1;
+    }
+  hash = mix64 (hash);
+  return hash ^ (hash >> 32);
+}
+
+/* Returns a hash of string S, which depends on SEED.  Equivalent
+   to hash_bytes_seed() on the bytes of S without the null
+   terminator; strlen() already scans a word at a time. */
+unsigned
+hash_string_seed (const char *s, uint64_t seed)
+{
+  ASSERT (s != NULL);
+  return hash_bytes_seed (s, strlen (s), seed);
+}
+
+/* Returns a hash of integer I, which depends on SEED.  Unlike
+   hash_int_fnv(), every bit of I affects every bit of the
+   result, so consecutive or evenly spaced integers spread over
+   all the buckets of a table. */
+unsigned
+hash_int_seed (int i, uint64_t seed)
+{
+  uint64_t hash = mix64 ((uint32_t) i ^ seed * PRIME64_1);
+  return hash ^ (hash >> 32);
+}
+
+/* Returns the CRC-32C of the SIZE bytes in BUF, starting from a
+   value derived from SEED.  Uses the CPU's CRC32 instruction
+   when it has one, which makes this the fastest of the hash
+   functions for long inputs, but a CRC is linear, so it is a
+   poor choice against an adversary even with a secret seed. */
+unsigned
+hash_crc32c (const void *buf, size_t size, uint64_t seed)
+{
+  unsigned crc = ~(unsigned) (seed ^ (seed >> 32));
+  return ~simd_crc32c (buf, size, crc);
+}
+
+/* Returns the hash value of E for use in H: the result of H's
+   hash function, mixed with H's seed if it has one. */
+static unsigned
+table_hash (struct hash *h, struct hash_elem *e)
+{
+  unsigned hash = h->hash (e, h->aux);
+
+  if (h->seed != 0)
+    {
+      uint64_t x = mix64 (hash ^ h->seed);
+      hash = x ^ (x >> 32);
+    }
+  return hash;
+}
+
+/* Returns the hash value of E, an element of H, without calling
+   the hash function if H caches hash values. */
+static inline unsigned
+elem_hash (struct hash *h, struct hash_elem *e)
+{
+  return h->cache_hashes ? *cached_hash (h, e) : table_hash (h, e);
+}
+
+/* Returns true if the elements A and B of H are equal, using
+   H's equality function if it has one and otherwise two calls to
+   its less function. */
+static inline bool
+elems_equal (struct hash *h, struct hash_elem *a, struct hash_elem *b)
+{
+  if (h->eq != NULL)
+    return h->eq (a, b, h->aux);
+  return !h->less (a, b, h->aux) && !h->less (b, a, h->aux);
+}
+
+/* Returns the bucket in H that E, an element of H, belongs in. */
 static struct list *
 find_bucket (struct hash *h, struct hash_elem *e) 
 {
-  size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
+  size_t bucket_idx = elem_hash (h, e) & (h->bucket_cnt - 1);
   return &h->buckets[bucket_idx];
 }
 
-/* Searches BUCKET in H for a hash element equal to E.  Returns
-   it if found or a null pointer otherwise. */
+/* Searches BUCKET in H for a hash element equal to E, whose hash
+   value is HASH.  Returns it if found or a null pointer
+   otherwise.  If H caches hash values, elements with a different
+   hash value are skipped without calling the comparison
+   function. */
 static struct hash_elem *
-find_elem (struct hash *h, struct list *bucket, struct hash_elem *e) 
+find_elem (struct hash *h, struct list *bucket, struct hash_elem *e,
+           unsigned hash) 
 {
   struct list_elem *i;
 
   for (i = list_begin (bucket); i != list_end (bucket); i = list_next (i)) 
     {
       struct hash_elem *hi = list_elem_to_hash_elem (i);
-      if (!h->less (hi, e, h->aux) && !h->less (e, hi, h->aux))
+      if (h->cache_hashes && *cached_hash (h, hi) != hash)
+        continue;
+      if (elems_equal (h, hi, e))
         return hi; 
     }
   return NULL;
 }
 
+/* Searches H for an element equal to E, whose hash value is
+   HASH, in the old buckets too while a rehash is in progress.
+   Returns it if found or a null pointer otherwise.  If BUCKET is
+   non-null, stores in *BUCKET the bucket that E belongs in,
+   which is always one of the current buckets. */
+static struct hash_elem *
+lookup (struct hash *h, struct hash_elem *e, unsigned hash,
+        struct list **bucket)
+{
+  struct list *b = &h->buckets[hash & (h->bucket_cnt - 1)];
+  struct hash_elem *found = find_elem (h, b, e, hash);
+
+  if (found == NULL && h->old_bucket_cnt != 0)
+    {
+      size_t old_idx = hash & (h->old_bucket_cnt - 1);
+      if (old_idx >= h->migrate_idx)
+        found = find_elem (h, &h->old_buckets[old_idx], e, hash);
+    }
+  if (bucket != NULL)
+    *bucket = b;
+  return found;
+}
+
+/* Returns bucket IDX of H, counting the current buckets first
+   and then the old buckets of a rehash in progress. */
+static struct list *
+bucket_at (struct hash *h, size_t idx)
+{
+  if (idx < h->bucket_cnt)
+    return &h->buckets[idx];
+  return &h->old_buckets[idx - h->bucket_cnt];
+}
+
+/* Returns a pointer to slot IDX of H, an element pointer for
+   HASH_OPEN and the head of a chain for HASH_COMPACT, counting
+   the current slots first and then the old slots of a rehash in
+   progress. */
+static struct hash_elem **
+slot_at (struct hash *h, size_t idx)
+{
+  if (idx < h->bucket_cnt)
+    return &h->slots[idx];
+  return &h->old_slots[idx - h->bucket_cnt];
+}
+
+/* Compact chaining.
+
+   A HASH_COMPACT table works like a chained one, with the same
+   bucket counts and resizing, but each bucket is just a pointer
+   to the first element of a singly linked chain, kept in the
+   SLOTS array, and the elements are linked through their `next'
+   members.  That takes a quarter of the memory of a struct list
+   per bucket.  The `next' member leaves room in struct hash_elem
+   for the element's hash value, so the table always caches it:
+   migrating an element never calls the hash function and the
+   search below only compares elements whose hash value matches.
+   Removing an element needs the pointer that points to it, which
+   the search finds along the way. */
+
+/* Returns the pointer in the chain that starts at *LINK that
+   points to the element of H equal to E, whose hash value is
+   HASH, or a null pointer if there is none. */
+static struct hash_elem **
+compact_search (struct hash *h, struct hash_elem **link,
+                struct hash_elem *e, unsigned hash)
+{
+  for (; *link != NULL; link = &(*link)->next)
+    if ((!h->cache_hashes || *cached_hash (h, *link) == hash)
+        && elems_equal (h, *link, e))
+      return link;
+  return NULL;
+}
+
+/* Returns the pointer in H that points to the element equal to
+   E, whose hash value is HASH, looking in the old chains too
+   while a rehash is in progress, or a null pointer if there is
+   no such element. */
+static struct hash_elem **
+compact_lookup (struct hash *h, struct hash_elem *e, unsigned hash)
+{
+  struct hash_elem **link;
+
+  link = compact_search (h, &h->slots[hash & (h->bucket_cnt - 1)], e, hash);
+  if (link == NULL && h->old_bucket_cnt != 0)
+    {
+      size_t old_idx = hash & (h->old_bucket_cnt - 1);
+      if (old_idx >= h->migrate_idx)
+        link = compact_search (h, &h->old_slots[old_idx], e, hash);
+    }
+  return link;
+}
+
+/* Pushes E, whose hash value is HASH, onto the front of its
+   chain among the current chains of H, without counting it as a
+   new element. */
+static void
+compact_push (struct hash *h, struct hash_elem *e, unsigned hash)
+{
+  struct hash_elem **head = &h->slots[hash & (h->bucket_cnt - 1)];
+
+  e->next = *head;
+  *head = e;
+}
+
 /* Returns X with its lowest-order bit set to 1 turned off. */
 static inline size_t
 turn_off_least_1bit (size_t x) 
@@ -343,72 +1062,173 @@ is_power_of_2 (size_t x)
 #define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
 #define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
 
-/* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
-   condition, but that'll just make hash accesses less efficient;
-   we can still continue. */
+/* Number of old buckets moved by each step of a rehash.  A
+   rehash must finish before the next one can start, and the next
+   one is only due after at least as many insertions or
+   deletions as there are old buckets, so this leaves plenty of
+   margin. */
+#define MIGRATE_BUCKETS 4
+
+/* Moves the elements of up to CNT old buckets of H into the
+   current buckets, and frees the old buckets once they are all
+   empty. */
 static void
-rehash (struct hash *h) 
+migrate (struct hash *h, size_t cnt)
 {
-  size_t old_bucket_cnt, new_bucket_cnt;
-  struct list *new_buckets, *old_buckets;
-  size_t i;
+  while (cnt-- > 0 && h->migrate_idx < h->old_bucket_cnt)
+    {
+      struct list *old_bucket;
 
-  ASSERT (h != NULL);
+      if (h->engine == HASH_COMPACT)
+        {
+          struct hash_elem *e = h->old_slots[h->migrate_idx];
+
+          h->old_slots[h->migrate_idx++] = NULL;
+          while (e != NULL)
+            {
+              struct hash_elem *next = e->next;
+              compact_push (h, e, elem_hash (h, e));
+              e = next;
+            }
+          continue;
+        }
+
+      old_bucket = &h->old_buckets[h->migrate_idx++];
+
+      while (!list_empty (old_bucket))
+        {
+          struct list_elem *elem = list_pop_front (old_bucket);
+          list_push_front (find_bucket (h, list_elem_to_hash_elem (elem)),
+                           elem);
+        }
+    }
+  if (h->migrate_idx >= h->old_bucket_cnt)
+    drop_old (h);
+}
 
-  /* Save old bucket info for later use. */
-  old_buckets = h->buckets;
-  old_bucket_cnt = h->bucket_cnt;
+/* Frees the old buckets or slots of H, which must not hold any
+   elements that are still needed, ending any rehash in
+   progress. */
+static void
+drop_old (struct hash *h)
+{
+  free (h->old_buckets);
+  free (h->old_ctrl);
+  free (h->old_slots);
+  h->old_buckets = NULL;
+  h->old_ctrl = NULL;
+  h->old_slots = NULL;
+  h->old_bucket_cnt = 0;
+  h->migrate_idx = 0;
+}
 
-  /* Calculate the number of buckets to use now.
-     We want one bucket for about every BEST_ELEMS_PER_BUCKET.
-     We must have at least four buckets, and the number of
-     buckets must be a power of 2. */
-  new_bucket_cnt = h->elem_cnt / BEST_ELEMS_PER_BUCKET;
-  if (new_bucket_cnt < 4)
-    new_bucket_cnt = 4;
-  while (!is_power_of_2 (new_bucket_cnt))
-    new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
+/* Returns the number of buckets to use for CNT elements.
+   We want one bucket for about every BEST_ELEMS_PER_BUCKET.
+   We must have at least four buckets, and the number of
+   buckets must be a power of 2, so we take the power of 2
+   nearest to CNT / BEST_ELEMS_PER_BUCKET.  Rounding down
+   instead would leave a table that shrinks because it fell
+   below MIN_ELEMS_PER_BUCKET right at MAX_ELEMS_PER_BUCKET, one
+   insertion away from growing again. */
+static size_t
+ideal_bucket_cnt (size_t cnt)
+{
+  size_t want = cnt / BEST_ELEMS_PER_BUCKET;
+  size_t bucket_cnt = want;
+
+  if (want < 4)
+    return 4;
+  while (!is_power_of_2 (bucket_cnt))
+    bucket_cnt = turn_off_least_1bit (bucket_cnt);
+  if (want - bucket_cnt >= bucket_cnt / 2)
+    bucket_cnt *= 2;
+  return bucket_cnt;
+}
 
-  /* Don't do anything if the bucket count wouldn't change. */
-  if (new_bucket_cnt == old_bucket_cnt)
-    return;
+/* Starts moving the elements of H into NEW_BUCKET_CNT new
+   buckets.  The current buckets become the old buckets, which
+   migrate() empties a few at a time.  Returns true if
+   successful, false if memory allocation failed, in which case H
+   is unchanged.  No rehash may be in progress. */
+static bool
+resize (struct hash *h, size_t new_bucket_cnt)
+{
+  struct list *new_buckets;
+  size_t i;
+
+  ASSERT (h->old_bucket_cnt == 0);
+
+  if (h->engine == HASH_COMPACT)
+    {
+      struct hash_elem **new_heads = calloc (new_bucket_cnt,
+                                             sizeof *new_heads);
+      if (new_heads == NULL)
+        return false;
+      h->old_slots = h->slots;
+      h->old_bucket_cnt = h->bucket_cnt;
+      h->migrate_idx = 0;
+      h->slots = new_heads;
+      h->bucket_cnt = new_bucket_cnt;
+      return true;
+    }
 
   /* Allocate new buckets and initialize them as empty. */
   new_buckets = malloc (sizeof *new_buckets * new_bucket_cnt);
   if (new_buckets == NULL) 
-    {
-      /* Allocation failed.  This means that use of the hash table will
-         be less efficient.  However, it is still usable, so
-         there's no reason for it to be an error. */
-      return;
-    }
+    return false;
   for (i = 0; i < new_bucket_cnt; i++) 
     list_init (&new_buckets[i]);
 
-  /* Install new bucket info. */
+  /* Install new bucket info, keeping the old buckets until their
+     elements have been moved. */
+  h->old_buckets = h->buckets;
+  h->old_bucket_cnt = h->bucket_cnt;
+  h->migrate_idx = 0;
   h->buckets = new_buckets;
   h->bucket_cnt = new_bucket_cnt;
+  return true;
+}
 
-  /* Move each old element into the appropriate new bucket. */
-  for (i = 0; i < old_bucket_cnt; i++) 
-    {
-      struct list *old_bucket;
-      struct list_elem *elem, *next;
+/* Changes the number of buckets in hash table H to the ideal if
+   the average number of elements per bucket has left the range
+   from MIN_ELEMS_PER_BUCKET to MAX_ELEMS_PER_BUCKET.  The gap
+   between the two and the ideal keeps a table whose size hovers
+   around a power of 2 from resizing back and forth.  H never
+   shrinks below the size requested with hash_reserve().  This
+   function can fail because of an out-of-memory condition, but
+   that'll just make hash accesses less efficient; we can still
+   continue.
+
+   The elements are not moved all at once.  Each call moves
+   MIGRATE_BUCKETS of the old buckets until none are left, while
+   lookups search both. */
+static void
+rehash (struct hash *h) 
+{
+  size_t new_bucket_cnt;
+
+  ASSERT (h != NULL);
 
-      old_bucket = &old_buckets[i];
-      for (elem = list_begin (old_bucket);
-           elem != list_end (old_bucket); elem = next) 
+  if (h->old_bucket_cnt == 0)
+    {
+      if (h->elem_cnt > h->bucket_cnt * MAX_ELEMS_PER_BUCKET)
+        new_bucket_cnt = ideal_bucket_cnt (h->elem_cnt);
+      else if (h->elem_cnt < h->bucket_cnt * MIN_ELEMS_PER_BUCKET)
         {
-          struct list *new_bucket
-            = find_bucket (h, list_elem_to_hash_elem (elem));
-          next = list_next (elem);
-          list_remove (elem);
-          list_push_front (new_bucket, elem);
+          new_bucket_cnt = ideal_bucket_cnt (h->elem_cnt);
+          if (new_bucket_cnt < ideal_bucket_cnt (h->reserve_cnt))
+            new_bucket_cnt = ideal_bucket_cnt (h->reserve_cnt);
         }
+      else
+        return;
+
+      /* If allocation fails, use of the hash table will be less
+         efficient.  However, it is still usable, so there's no
+         reason for it to be an error. */
+      if (new_bucket_cnt == h->bucket_cnt || !resize (h, new_bucket_cnt))
+        return;
     }
-
-  free (old_buckets);
+  migrate (h, MIGRATE_BUCKETS);
 }
 
 /* Inserts E into BUCKET (in hash table H). */
@@ -427,3 +1247,267 @@ remove_elem (struct hash *h, struct hash_elem *e)
   list_remove (&e->list_elem);
 }
 
+/* Open addressing.
+
+   The slots are divided into groups of SIMD_GROUP.  An element
+   with hash value HASH is stored in the first group along its
+   probe sequence that has a free slot, starting with group
+   (HASH >> 7) and moving on by 1, 2, 3, ... groups, which visits
+   every group when the number of groups is a power of 2.  A
+   lookup stops at the first group that contains an empty slot,
+   since an insertion would have used that slot.  The table is
+   kept at most 7/8 full, counting deleted slots, so that
+   sequences stay short. */
+
+/* Gives H a new, empty array of SLOT_CNT slots, a power of 2 that
+   is at least SIMD_GROUP, without freeing the old one.  Returns
+   true if successful, false on allocation failure, in which case
+   H is unchanged. */
+static bool
+open_alloc (struct hash *h, size_t slot_cnt)
+{
+  unsigned char *ctrl = malloc (slot_cnt);
+  struct hash_elem **slots = malloc (sizeof *slots * slot_cnt);
+
+  if (ctrl == NULL || slots == NULL)
+    {
+      free (ctrl);
+      free (slots);
+      return false;
+    }
+  memset (ctrl, CTRL_EMPTY, slot_cnt);
+  h->ctrl = ctrl;
+  h->slots = slots;
+  h->bucket_cnt = slot_cnt;
+  h->tomb_cnt = 0;
+  return true;
+}
+
+/* Returns a pointer to the control byte of slot IDX of H,
+   counting the current slots first and then the old slots of a
+   rehash in progress. */
+static unsigned char *
+open_ctrl (struct hash *h, size_t idx)
+{
+  if (idx < h->bucket_cnt)
+    return &h->ctrl[idx];
+  return &h->old_ctrl[idx - h->bucket_cnt];
+}
+
+
+/* Returns the index of the slot among the SLOT_CNT slots in CTRL
+   and SLOTS that holds an element of H equal to E, whose hash
+   value is HASH, or SIZE_MAX if there is none. */
+static size_t
+open_probe (struct hash *h, const unsigned char *ctrl_bytes,
+            struct hash_elem **slots, size_t slot_cnt,
+            struct hash_elem *e, unsigned hash)
+{
+  size_t group_cnt = slot_cnt / SIMD_GROUP;
+  size_t group = (hash >> 7) & (group_cnt - 1);
+  size_t i;
+
+  for (i = 0; i < group_cnt; i++)
+    {
+      const unsigned char *ctrl = ctrl_bytes + group * SIMD_GROUP;
+      unsigned match = simd_match_byte (ctrl, hash & 0x7f);
+
+      for (; match != 0; match &= match - 1)
+        {
+          size_t slot = group * SIMD_GROUP + __builtin_ctz (match);
+          if (h->cache_hashes && *cached_hash (h, slots[slot]) != hash)
+            continue;
+          if (elems_equal (h, slots[slot], e))
+            return slot;
+        }
+      if (simd_match_byte (ctrl, CTRL_EMPTY) != 0)
+        break;
+      group = (group + i + 1) & (group_cnt - 1);
+    }
+  return SIZE_MAX;
+}
+
+/* Returns the index, numbered as in open_ctrl(), of the slot in
+   H that holds an element equal to E, whose hash value is HASH,
+   or SIZE_MAX if there is none.  While a rehash is in progress,
+   elements not found in the current slots may still be in the
+   old ones. */
+static size_t
+open_find (struct hash *h, struct hash_elem *e, unsigned hash)
+{
+  size_t slot = open_probe (h, h->ctrl, h->slots, h->bucket_cnt, e, hash);
+
+  if (slot == SIZE_MAX && h->old_bucket_cnt != 0)
+    {
+      slot = open_probe (h, h->old_ctrl, h->old_slots, h->old_bucket_cnt,
+                         e, hash);
+      if (slot != SIZE_MAX)
+        slot += h->bucket_cnt;
+    }
+  return slot;
+}
+
+/* Returns the index of the first free slot, empty or deleted,
+   along the probe sequence for HASH in H, or SIZE_MAX if every
+   slot is full. */
+static size_t
+open_free_slot (struct hash *h, unsigned hash)
+{
+  size_t group_cnt = h->bucket_cnt / SIMD_GROUP;
+  size_t group = (hash >> 7) & (group_cnt - 1);
+  size_t i;
+
+  for (i = 0; i < group_cnt; i++)
+    {
+      const unsigned char *ctrl = h->ctrl + group * SIMD_GROUP;
+      unsigned match = (simd_match_byte (ctrl, CTRL_EMPTY)
+                        | simd_match_byte (ctrl, CTRL_DELETED));
+
+      if (match != 0)
+        return group * SIMD_GROUP + __builtin_ctz (match);
+      group = (group + i + 1) & (group_cnt - 1);
+    }
+  return SIZE_MAX;
+}
+
+/* Returns the number of slots to use for CNT elements: the
+   smallest power of 2 that keeps them under half load, and at
+   least SIMD_GROUP. */
+static size_t
+open_slot_cnt (size_t cnt)
+{
+  size_t slot_cnt = SIMD_GROUP;
+  while (slot_cnt < cnt * 2)
+    slot_cnt *= 2;
+  return slot_cnt;
+}
+
+/* Stores E, whose hash value is HASH, in free slot SLOT of the
+   current slots of H, without counting it as a new element. */
+static void
+open_store (struct hash *h, size_t slot, struct hash_elem *e, unsigned hash)
+{
+  if (h->ctrl[slot] == CTRL_DELETED)
+    h->tomb_cnt--;
+  h->ctrl[slot] = hash & 0x7f;
+  h->slots[slot] = e;
+}
+
+/* Number of old slots moved by each step of a rehash of an open
+   table: four groups. */
+#define MIGRATE_SLOTS (4 * SIMD_GROUP)
+
+/* Moves the elements in up to CNT old slots of H into the
+   current slots, and frees the old slots once they have all been
+   moved.  A moved element's old slot is marked deleted, so that
+   lookups in the old slots still probe past it.
+
+   The current slots always have room: the load check in
+   open_insert() counts the elements still in the old slots. */
+static void
+open_migrate (struct hash *h, size_t cnt)
+{
+  while (cnt-- > 0 && h->migrate_idx < h->old_bucket_cnt)
+    {
+      size_t idx = h->migrate_idx++;
+
+      if (h->old_ctrl[idx] < CTRL_EMPTY)
+        {
+          struct hash_elem *e = h->old_slots[idx];
+          unsigned hash = elem_hash (h, e);
+          size_t slot = open_free_slot (h, hash);
+
+          ASSERT (slot != SIZE_MAX);
+          open_store (h, slot, e, hash);
+          h->old_ctrl[idx] = CTRL_DELETED;
+        }
+    }
+  if (h->migrate_idx >= h->old_bucket_cnt)
+    drop_old (h);
+}
+
+/* Stores E, whose hash value is HASH and which is not equal to
+   any element of H, in H.  Grows H first if it is too full.
+   If H is completely full and cannot grow, there is no way to
+   report failure to the caller, so running out of memory here
+   is fatal. */
+static void
+open_insert (struct hash *h, struct hash_elem *e, unsigned hash)
+{
+  size_t slot;
+
+  if ((h->elem_cnt + h->tomb_cnt + 1) * 8 > h->bucket_cnt * 7)
+    open_rehash (h, h->elem_cnt + 1);
+  slot = open_free_slot (h, hash);
+  if (slot == SIZE_MAX)
+    {
+      fprintf (stderr, "hash: out of memory growing table\n");
+      abort ();
+    }
+  open_store (h, slot, e, hash);
+  h->elem_cnt++;
+  if (h->old_bucket_cnt != 0)
+    open_migrate (h, MIGRATE_SLOTS);
+}
+
+/* Removes the element in slot IDX, numbered as in open_ctrl(),
+   from H.  A current slot becomes empty if its group already has
+   an empty slot, because then no probe sequence continues past
+   the group; otherwise it must be marked deleted so that lookups
+   keep going.  Old slots are always marked deleted, since they
+   are freed once the rehash finishes anyway.  Shrinks H if it
+   has become very sparse. */
+static void
+open_remove (struct hash *h, size_t idx)
+{
+  if (idx >= h->bucket_cnt)
+    h->old_ctrl[idx - h->bucket_cnt] = CTRL_DELETED;
+  else if (simd_match_byte (h->ctrl + idx / SIMD_GROUP * SIMD_GROUP,
+                            CTRL_EMPTY) != 0)
+    h->ctrl[idx] = CTRL_EMPTY;
+  else
+    {
+      h->ctrl[idx] = CTRL_DELETED;
+      h->tomb_cnt++;
+    }
+  h->elem_cnt--;
+  if (h->elem_cnt * 8 < h->bucket_cnt
+      && h->bucket_cnt > open_slot_cnt (h->reserve_cnt))
+    open_rehash (h, h->elem_cnt > h->reserve_cnt
+                    ? h->elem_cnt : h->reserve_cnt);
+  else if (h->old_bucket_cnt != 0)
+    open_migrate (h, MIGRATE_SLOTS);
+}
+
+/* Starts moving the elements of H into a new array with room for
+   NEED_CNT elements at less than half load, which drops deleted
+   slots.  Any rehash already in progress is finished first.  The
+   current slots become the old slots, and each later insertion
+   or deletion moves MIGRATE_SLOTS of them, so that no single
+   operation pays for copying the whole table.  Like rehash(),
+   this only makes H less efficient if memory allocation fails,
+   so the return value, false in that case, matters only to
+   hash_reserve(). */
+static bool
+open_rehash (struct hash *h, size_t need_cnt)
+{
+  unsigned char *old_ctrl;
+  struct hash_elem **old_slots;
+  size_t old_cnt;
+
+  if (h->old_bucket_cnt != 0)
+    open_migrate (h, SIZE_MAX);
+
+  old_ctrl = h->ctrl;
+  old_slots = h->slots;
+  old_cnt = h->bucket_cnt;
+  if (!open_alloc (h, open_slot_cnt (need_cnt)))
+    return false;
+
+  h->old_ctrl = old_ctrl;
+  h->old_slots = old_slots;
+  h->old_bucket_cnt = old_cnt;
+  h->migrate_idx = 0;
+  open_migrate (h, MIGRATE_SLOTS);
+  return true;
+}
@@ -15,17 +15,78 @@
    conversion from a struct hash_elem back to a structure object
    that contains it.  This is the same technique used in the
    linked list implementation.  Refer to ./list.h for a
-   detailed explanation. */
+   detailed explanation.
+
+   A table initialized with hash_init_engine() and HASH_OPEN
+   instead uses open addressing: an array of pointers to
+   elements, plus one control byte per slot holding 7 bits of the
+   element's hash value.  A lookup compares 16 control bytes at
+   once with SIMD instructions and only calls the comparison
+   function for slots whose bits match, so it usually touches one
+   line of control bytes and the one element it is looking for,
+   instead of every element in a chain.  Such a table does not
+   link the struct hash_elem into a list, but it must still be
+   embedded so that the same code works with every engine.
+
+   HASH_COMPACT keeps chaining but makes each bucket a single
+   pointer to a singly linked chain instead of a struct list, a
+   quarter of the size, which matters most for tables of many
+   small elements.  Its link in struct hash_elem is a `next'
+   pointer plus the element's cached hash value, in the space of
+   a list_elem, so it gets the benefits of hash_cache_hashes()
+   without the larger struct hash_cached_elem that a chained
+   table needs for them.  Deleting from such a chain walks it
+   with a pointer to the previous link, so it costs no more than
+   a lookup.
+
+   Whatever the engine, a table that has to grow or shrink does not move
+   all of its elements at once.  It allocates the new array and
+   then moves a few buckets or slots from the old one on each
+   insertion or deletion, looking in both arrays in the
+   meantime, so that no single operation takes time proportional
+   to the size of the table.  A table grows and shrinks at
+   thresholds well apart from each other, so that one whose size
+   hovers around a boundary does not resize back and forth.
+   Iteration visits the buckets in order, so the order in which
+   elements come out depends on when the table last resized; in
+   particular it differs from that of a table that resizes on
+   every insertion and deletion once it holds more than about 20
+   elements.
+   hash_reserve() sizes a table in advance for a known number of
+   elements and hash_shrink_to_fit() releases unneeded space. */
 
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include "list.h"
 
-/* Hash element. */
+/* Hash element.  Whatever the engine, it is the size of a
+   list_elem. */
 struct hash_elem 
   {
-    struct list_elem list_elem;
+    union
+      {
+        struct list_elem list_elem;     /* HASH_CHAINED: bucket list. */
+        struct
+          {
+            struct hash_elem *next;     /* HASH_COMPACT: next in chain. */
+            unsigned hash;              /* HASH_COMPACT, HASH_OPEN:
+                                           cached hash value. */
+          };
+      };
+  };
+
+/* Hash element with room for a cached hash value.  A HASH_CHAINED
+   table that caches hash values, see hash_cache_hashes(), keeps
+   each element's hash value here, so the structures that go into
+   such a table must embed this instead of a plain struct
+   hash_elem and pass a pointer to its ELEM member to the hash
+   functions.  Structures that never go into such a table do not
+   pay for the extra member. */
+struct hash_cached_elem
+  {
+    struct hash_elem elem;      /* Must be first. */
+    unsigned hash;              /* Cached hash value. */
   };
 
 /* Computes and returns the hash value for hash element E, given
@@ -39,19 +100,63 @@ typedef bool hash_less_func (const struct hash_elem *a,
                              const struct hash_elem *b,
                              void *aux);
 
+/* Returns true if hash elements A and B are equal, given
+   auxiliary data AUX. */
+typedef bool hash_eq_func (const struct hash_elem *a,
+                           const struct hash_elem *b,
+                           void *aux);
+
 /* Performs some operation on hash element E, given auxiliary
    data AUX. */
 typedef void hash_action_func (struct hash_elem *e, void *aux);
 
+/* Storage engines for hash_init_engine(). */
+enum hash_engine
+  {
+    HASH_CHAINED,               /* Buckets of linked lists. */
+    HASH_OPEN,                  /* Open addressing with control bytes. */
+    HASH_COMPACT                /* Buckets of singly linked chains. */
+  };
+
 /* Hash table. */
 struct hash 
   {
     size_t elem_cnt;            /* Number of elements in table. */
-    size_t bucket_cnt;          /* Number of buckets, a power of 2. */
+    size_t bucket_cnt;          /* Number of buckets or slots, a power of 2. */
     struct list *buckets;       /* Array of `bucket_cnt' lists. */
     hash_hash_func *hash;       /* Hash function. */
     hash_less_func *less;       /* Comparison function. */
+    hash_eq_func *eq;           /* Equality function, or null. */
     void *aux;                  /* Auxiliary data for `hash' and `less'. */
+    enum hash_engine engine;    /* Storage engine. */
+    unsigned char *ctrl;        /* HASH_OPEN: control byte per slot. */
+    struct hash_elem **slots;   /* HASH_OPEN: `bucket_cnt' slots.
+                                   HASH_COMPACT: `bucket_cnt' chains. */
+    size_t tomb_cnt;            /* HASH_OPEN: number of deleted slots. */
+    size_t reserve_cnt;         /* Never shrink below room for this many. */
+    bool cache_hashes;          /* Store hash values of elements? */
+    uint64_t seed;              /* Mixed into hash values, if nonzero. */
+
+    /* Buckets or slots being migrated by an incremental rehash.
+       `old_bucket_cnt' is 0 when no rehash is in progress. */
+    size_t old_bucket_cnt;      /* Number of old buckets or slots. */
+    size_t migrate_idx;         /* First old one not yet migrated. */
+    struct list *old_buckets;   /* Old buckets. */
+    unsigned char *old_ctrl;    /* HASH_OPEN: old control bytes. */
+    struct hash_elem **old_slots;       /* Old slots or chains. */
+  };
+
+/* Size of the histogram in struct hash_stats. */
+#define HASH_STATS_HIST 8
+
+/* Statistics filled in by hash_get_stats(). */
+struct hash_stats
+  {
+    size_t bucket_cnt;          /* Buckets or slots, old ones included. */
+    size_t empty_cnt;           /* Empty buckets or slots. */
+    size_t max_len;             /* Longest chain or probe sequence. */
+    double avg_probe;           /* Average cost of a successful lookup. */
+    size_t histogram[HASH_STATS_HIST];  /* Chain or probe lengths. */
   };
 
 /* A hash table iterator. */
@@ -60,16 +165,29 @@ struct hash_iterator
     struct hash *hash;          /* The hash table. */
     struct list *bucket;        /* Current bucket. */
     struct hash_elem *elem;     /* Current hash element in current bucket. */
+    size_t slot;                /* Index of current bucket or slot. */
   };
 
 /* Basic life cycle. */
 bool hash_init (struct hash *, hash_hash_func *, hash_less_func *, void *aux);
+bool hash_init_engine (struct hash *, enum hash_engine,
+                       hash_hash_func *, hash_less_func *, void *aux);
+void hash_cache_hashes (struct hash *, bool cache);
+void hash_set_eq (struct hash *, hash_eq_func *);
+void hash_set_seed (struct hash *, uint64_t seed);
 void hash_clear (struct hash *, hash_action_func *);
 void hash_destroy (struct hash *, hash_action_func *);
 
+/* Capacity. */
+bool hash_reserve (struct hash *, size_t);
+void hash_shrink_to_fit (struct hash *);
+
 /* Search, insertion, deletion. */
 struct hash_elem *hash_insert (struct hash *, struct hash_elem *);
 struct hash_elem *hash_replace (struct hash *, struct hash_elem *);
+struct hash_elem *hash_find_or_insert (struct hash *, struct hash_elem *);
+struct hash_elem *hash_upsert (struct hash *, struct hash_elem *,
+                               hash_action_func *update);
 struct hash_elem *hash_find (struct hash *, struct hash_elem *);
 struct hash_elem *hash_delete (struct hash *, struct hash_elem *);
 
@@ -82,10 +200,21 @@ struct hash_elem *hash_cur (struct hash_iterator *);
 /* Information. */
 size_t hash_size (struct hash *);
 bool hash_empty (struct hash *);
+void hash_get_stats (struct hash *, struct hash_stats *);
 
-/* Sample hash functions. */
+/* Sample hash functions.  hash_bytes() and hash_string() hash a
+   byte at a time with FNV-1 and are kept for compatibility, as is
+   hash_int_fnv(), the FNV-1 hash_int() of earlier versions; the
+   seeded functions below are faster and mix better. */
 unsigned hash_bytes (const void *, size_t);
 unsigned hash_string (const char *);
 unsigned hash_int (int);
+unsigned hash_int_fnv (int);
+
+/* Seeded hash functions. */
+unsigned hash_bytes_seed (const void *, size_t, uint64_t seed);
+unsigned hash_string_seed (const char *, uint64_t seed);
+unsigned hash_int_seed (int, uint64_t seed);
+unsigned hash_crc32c (const void *, size_t, uint64_t seed);
 
 #endif /* hash.h */
@@ -8,6 +8,9 @@
  #include "list.h"
  #include "hash.h"
  #include "bitmap.h"
+ #include "cbitmap.h"
+ #include "bloom.h"
+ #include "buddy.h"
  #include "debug.h"
  #include "hex_dump.h"  // hex_dump 함수 선언 포함
  
@@ -26,6 +29,9 @@
  struct list *list_arr[MAX_OBJECTS];
  struct hash *hash_arr[MAX_OBJECTS];
  struct bitmap *bmp_arr[MAX_OBJECTS];
+ struct cbitmap *cbmp_arr[MAX_OBJECTS];    // "create bitmap ... compressed"로 생성한 압축 비트맵
+ struct buddy *buddy_arr[MAX_OBJECTS];
+ struct bloom *bloom_arr[MAX_OBJECTS];
  
  /* 사용자 정의 리스트 요소 구조체 */
  struct list_node {
@@ -35,7 +41,7 @@
  
  /* 사용자 정의 해시 테이블 요소 구조체 */
  struct hash_node {
-     struct list_elem hash_link;  // 해시 테이블 내부 리스트 연결 요소
+     struct hash_elem hash_link;  // 해시 테이블 연결 요소
      int num_value;              // 저장 데이터
  };
  
@@ -54,6 +60,23 @@
      return (*obj_name) ? atoi(obj_name) : -1;
  }
  
+ /*
+  * parse_bool_token:
+  *   - "true" 또는 "false" 문자열을 bool 값으로 변환하여 value에 저장.
+  *   - 둘 다 아니면 오류 메시지를 출력하고 false를 반환.
+  */
+ bool parse_bool_token(const char *token, bool *value) {
+     if (strcmp(token, "true") == 0)
+         *value = true;
+     else if (strcmp(token, "false") == 0)
+         *value = false;
+     else {
+         printf("Invalid value. Please enter 'true' or 'false'.\n");
+         return false;
+     }
+     return true;
+ }
+ 
  /*
   * split_line:
   *   - 입력 문자열(inputBuffer)을 공백, 탭, 개행문자를 기준으로 토큰화하여 token_arr 배열에 저장.
@@ -157,14 +180,22 @@
  /*   해시 테이블 관련 함수들   */
  /* ---------------------- */
  
+ /* 정수 해시 함수 선택 항목: "create hashtable <이름> <함수>"의 <함수> 이름과 함수 */
+ struct int_hash_func {
+     const char *name;
+     unsigned (*func)(int);
+     bool seeded;    // 테이블마다 무작위 시드를 hash_set_seed()로 지정할지 여부
+ };
+ 
  /*
   * compute_hash:
   *   - 해시 요소의 num_value 값을 기반으로 해싱 처리.
-  *   - hash_int() 함수 사용.
+  *   - aux_data가 가리키는 int_hash_func의 함수를 사용하고, NULL이면 hash_int() 사용.
   */
  unsigned compute_hash(const struct hash_elem *hash_elem_ptr, void *aux_data) {
      struct hash_node *node_ptr = hash_entry(hash_elem_ptr, struct hash_node, hash_link);
-     return hash_int(node_ptr->num_value);
+     const struct int_hash_func *hash_func = aux_data;
+     return hash_func != NULL ? hash_func->func(node_ptr->num_value) : hash_int(node_ptr->num_value);
  }
  
  /*
@@ -187,6 +218,38 @@
      return (u * 2654435761u) ^ (u >> 16);
  }
  
+ /*
+  * crc_hash_int:
+  *   - 정수의 바이트열에 CRC32C를 적용한 해시 함수.
+  */
+ unsigned crc_hash_int(int num) {
+     return hash_crc32c(&num, sizeof num, 0);
+ }
+ 
+ /*
+  * 해시 테이블 생성 시 선택할 수 있는 정수 해시 함수들 (첫 항목이 기본값)
+  *   - "seed"는 hash_int()에 테이블마다 다른 무작위 시드를 섞으므로 실행할 때마다 출력 순서가 달라짐.
+  */
+ const struct int_hash_func int_hash_funcs[] = {
+     { "mix", hash_int, false },
+     { "fnv", hash_int_fnv, false },
+     { "mult", alternate_hash_int, false },
+     { "crc", crc_hash_int, false },
+     { "seed", hash_int, true },
+ };
+ 
+ /*
+  * find_int_hash_func:
+  *   - 이름에 해당하는 정수 해시 함수 항목을 반환.
+  *   - 없으면 NULL을 반환.
+  */
+ const struct int_hash_func *find_int_hash_func(const char *func_name) {
+     for (size_t i = 0; i < sizeof int_hash_funcs / sizeof *int_hash_funcs; i++)
+         if (strcmp(int_hash_funcs[i].name, func_name) == 0)
+             return &int_hash_funcs[i];
+     return NULL;
+ }
+ 
  /* ---------------------- */
  /*    비트맵 관련 함수들    */
  /* ---------------------- */
@@ -194,19 +257,14 @@
  /*
   * expand_bitmap:
   *   - 기존 비트맵보다 큰 new_capacity로 비트맵 확장.
-  *   - 기존 비트맵의 값을 새로운 비트맵에 복사한 후, 기존 비트맵을 해제.
+  *   - bitmap_resize로 기존 비트맵을 제자리에서 늘리므로 비트를 복사하지 않음.
+  *   - 확장에 실패하면 기존 비트맵을 그대로 유지.
   */
  struct bitmap *expand_bitmap(struct bitmap *bmp, int new_capacity) {
      if (new_capacity <= bitmap_size(bmp))
          return bmp;
-     struct bitmap *new_bmp = bitmap_create(new_capacity);
-     if (!new_bmp)
-         return NULL;
-     size_t current_size = bitmap_size(bmp);
-     for (size_t i = 0; i < current_size; i++)
-         bitmap_set(new_bmp, i, bitmap_test(bmp, i));
-     bitmap_destroy(bmp);
-     return new_bmp;
+     bitmap_resize(bmp, new_capacity);
+     return bmp;
  }
  
  /* ---------------------- */
@@ -216,14 +274,24 @@
  /*
   * init_hash_table:
   *   - 주어진 이름에 해당하는 인덱스에 해시 테이블을 생성 및 초기화.
+  *   - func_name으로 해시 함수를 선택하며, NULL이면 hash_int()를 사용.
+  *   - 시드를 쓰는 함수이면 현재 시각과 테이블 주소로 만든 시드를 hash_set_seed()로 지정.
+  *   - 알 수 없는 함수 이름이면 오류 메시지를 출력하고 생성하지 않음.
   */
- void init_hash_table(const char *table_name) {
+ void init_hash_table(const char *table_name, const char *func_name) {
      int index = extract_index_from_name(table_name);
      if (index < 0 || index >= MAX_OBJECTS)
          return;
+     const struct int_hash_func *hash_func = &int_hash_funcs[0];
+     if (func_name != NULL && (hash_func = find_int_hash_func(func_name)) == NULL) {
+         printf("Unknown hash function '%s'.\n", func_name);
+         return;
+     }
      hash_arr[index] = malloc(sizeof(struct hash));
      if (hash_arr[index] != NULL) {
-         hash_init(hash_arr[index], compute_hash, compare_hash_elements, NULL);
+         hash_init(hash_arr[index], compute_hash, compare_hash_elements, (void *)hash_func);
+         if (hash_func->seeded)
+             hash_set_seed(hash_arr[index], ((uint64_t)time(NULL) << 32 ^ (uintptr_t)hash_arr[index]) | 1);
      }
  }
  
@@ -238,6 +306,40 @@
      bmp_arr[index] = bitmap_create(bit_count);
  }
  
+ /*
+  * init_cbitmap:
+  *   - 주어진 이름과 비트 수로 압축 비트맵을 생성.
+  *   - 대부분 비어 있거나 긴 연속 구간으로 이루어진 큰 비트맵에 적합.
+  */
+ void init_cbitmap(const char *bitmap_name, size_t bit_count) {
+     int index = extract_index_from_name(bitmap_name);
+     if (index < 0 || index >= MAX_OBJECTS)
+         return;
+     cbmp_arr[index] = cbitmap_create(bit_count);
+ }
+ 
+ /*
+  * init_buddy:
+  *   - 주어진 이름과 크기로 버디 할당자를 생성.
+  */
+ void init_buddy(const char *buddy_name, size_t size) {
+     int index = extract_index_from_name(buddy_name);
+     if (index < 0 || index >= MAX_OBJECTS)
+         return;
+     buddy_arr[index] = buddy_create(size);
+ }
+ 
+ /*
+  * init_bloom:
+  *   - 주어진 이름으로 비트 수가 bit_count이고 키마다 hash_count개의 비트를 쓰는 블룸 필터를 생성.
+  */
+ void init_bloom(const char *bloom_name, size_t bit_count, int hash_count) {
+     int index = extract_index_from_name(bloom_name);
+     if (index < 0 || index >= MAX_OBJECTS || hash_count <= 0)
+         return;
+     bloom_arr[index] = bloom_create(bit_count, hash_count);
+ }
+ 
  /*
   * init_list:
   *   - 주어진 이름에 해당하는 인덱스에 리스트를 생성 및 초기화.
@@ -259,6 +361,7 @@
  void reset_bitmap_array() {
      for (int idx = 0; idx < MAX_OBJECTS; idx++) {
          bmp_arr[idx] = NULL;
+         cbmp_arr[idx] = NULL;
      }
  }
  
@@ -275,12 +378,64 @@
  /*
   * print_bitmap_binary:
   *   - 비트맵의 각 비트를 0 또는 1로 출력.
+  *   - '0'으로 채운 줄에 반복자가 돌려주는 켜진 비트만 '1'로 표시하여 한 번에 출력.
   */
  void print_bitmap_binary(const struct bitmap *bmp) {
      if (!bmp)
          return;
-     for (size_t i = 0; i < bitmap_size(bmp); i++) {
-         printf("%d", bitmap_test(bmp, i) ? 1 : 0);
+     size_t size = bitmap_size(bmp);
+     char *line = malloc(size + 1);
+     if (!line)
+         return;
+     memset(line, '0', size);
+     struct bitmap_iter iter;
+     size_t bit_index;
+     bitmap_iter_init(&iter, bmp);
+     while ((bit_index = bitmap_iter_next(&iter)) != BITMAP_ERROR)
+         line[bit_index] = '1';
+     line[size] = '\n';
+     fwrite(line, 1, size + 1, stdout);
+     free(line);
+     fflush(stdout);
+ }
+ 
+ /*
+  * print_cbitmap_binary:
+  *   - 압축 비트맵의 각 비트를 0 또는 1로 출력.
+  */
+ void print_cbitmap_binary(const struct cbitmap *cbmp) {
+     if (!cbmp)
+         return;
+     size_t size = cbitmap_size(cbmp);
+     char *line = malloc(size + 1);
+     if (!line)
+         return;
+     memset(line, '0', size);
+     size_t bit_index = cbitmap_next_set(cbmp, 0);
+     while (bit_index != BITMAP_ERROR) {
+         line[bit_index] = '1';
+         bit_index = cbitmap_next_set(cbmp, bit_index + 1);
+     }
+     line[size] = '\n';
+     fwrite(line, 1, size + 1, stdout);
+     free(line);
+     fflush(stdout);
+ }
+ 
+ /*
+  * print_buddy_free_blocks:
+  *   - 버디 할당자의 차수별 빈 블록 수를 "차수:개수" 형식으로 출력 (빈 블록이 있는 차수만).
+  */
+ void print_buddy_free_blocks(const struct buddy *allocator) {
+     bool first_output = true;
+     for (int order = 0; order < buddy_order_cnt(allocator); order++) {
+         size_t free_count = buddy_free_blocks(allocator, order);
+         if (free_count == 0)
+             continue;
+         if (!first_output)
+             printf(" ");
+         printf("%d:%zu", order, free_count);
+         first_output = false;
      }
      printf("\n");
      fflush(stdout);
@@ -298,6 +453,12 @@
  /*
   * print_hash_table:
   *   - 해시 테이블의 모든 요소를 출력.
+  *   - 출력 순서는 버킷 순서이므로 버킷 수를 바꾸는 시점에 따라 달라짐.
+  *     테이블은 버킷당 요소가 1개 미만이거나 4개를 넘을 때만 크기를 바꾸므로(hash.c의 rehash),
+  *     삽입/삭제마다 크기를 맞추던 원래 구현과 비교하면 요소가 약 20개를 넘는 테이블은
+  *     같은 명령에 대해 내용은 같지만 순서가 다르게 출력될 수 있음.
+  *   - 기본 해시 함수 hash_int()도 FNV-1에서 64비트 믹서로 바뀌었으므로 순서가 달라짐.
+  *     원래 함수는 "create hashtable <이름> fnv"로 선택할 수 있음.
   */
  void print_hash_table(const struct hash *hashTbl) {
      if (!hashTbl)
@@ -332,7 +493,7 @@
  struct hash_elem *find_element_by_value(struct hash *hashTbl, int search_value) {
      struct hash_node tmp_node;
      tmp_node.num_value = search_value;
-     return hash_find(hashTbl, (struct hash_elem *)&tmp_node.hash_link);
+     return hash_find(hashTbl, &tmp_node.hash_link);
  }
  
  /*
@@ -357,6 +518,10 @@
  /*
   * process_create_command:
   *   - "create" 명령어를 처리하여 list, hashtable, bitmap 생성.
+  *   - "create hashtable <이름> [mix|fnv|mult|crc|seed]"는 해시 함수를 선택하여 해시 테이블을 생성.
+  *   - "create bitmap <이름> <비트 수> compressed"는 압축 비트맵을 생성.
+  *   - "create buddy <이름> <크기>"는 버디 할당자를 생성.
+  *   - "create bloom <이름> <비트 수> <해시 수>"는 블룸 필터를 생성.
   */
  void process_create_command(char **cmd_tokens, int token_count) {
      if (token_count < 3)
@@ -365,11 +530,23 @@
          init_list(cmd_tokens[2]);
      }
      else if (strcmp(cmd_tokens[1], "hashtable") == 0) {
-         init_hash_table(cmd_tokens[2]);
+         init_hash_table(cmd_tokens[2], token_count >= 4 ? cmd_tokens[3] : NULL);
      }
      else if (strcmp(cmd_tokens[1], "bitmap") == 0 && token_count >= 4) {
          size_t bit_count = (size_t)atoi(cmd_tokens[3]);
-         init_bitmap(cmd_tokens[2], bit_count);
+         if (token_count >= 5 && strcmp(cmd_tokens[4], "compressed") == 0)
+             init_cbitmap(cmd_tokens[2], bit_count);
+         else
+             init_bitmap(cmd_tokens[2], bit_count);
+     }
+     else if (strcmp(cmd_tokens[1], "buddy") == 0 && token_count >= 4) {
+         size_t size = (size_t)atol(cmd_tokens[3]);
+         init_buddy(cmd_tokens[2], size);
+     }
+     else if (strcmp(cmd_tokens[1], "bloom") == 0 && token_count >= 5) {
+         size_t bit_count = (size_t)atol(cmd_tokens[3]);
+         int hash_count = atoi(cmd_tokens[4]);
+         init_bloom(cmd_tokens[2], bit_count, hash_count);
      }
  }
  
@@ -397,6 +574,18 @@
          bitmap_destroy(bmp_arr[index]);
          bmp_arr[index] = NULL;
      }
+     else if (cbmp_arr[index] != NULL) {
+         cbitmap_destroy(cbmp_arr[index]);
+         cbmp_arr[index] = NULL;
+     }
+     else if (buddy_arr[index] != NULL) {
+         buddy_destroy(buddy_arr[index]);
+         buddy_arr[index] = NULL;
+     }
+     else if (bloom_arr[index] != NULL) {
+         bloom_destroy(bloom_arr[index]);
+         bloom_arr[index] = NULL;
+     }
  }
  
  /*
@@ -426,6 +615,15 @@
      else if (bmp_arr[index] != NULL) {
          print_bitmap_binary(bmp_arr[index]);
      }
+     else if (cbmp_arr[index] != NULL) {
+         print_cbitmap_binary(cbmp_arr[index]);
+     }
+     else if (buddy_arr[index] != NULL) {
+         print_buddy_free_blocks(buddy_arr[index]);
+     }
+     else if (bloom_arr[index] != NULL) {
+         print_bitmap_binary(bloom_bitmap(bloom_arr[index]));
+     }
      fflush(stdout);
  }
  
@@ -433,6 +631,7 @@
   * process_hash_command:
   *   - 해시 테이블 관련 명령어 처리.
   *   - hash_apply, hash_clear, hash_delete, hash_empty, hash_find, hash_insert, hash_replace, hash_size 등.
+  *   - hash_stats는 버킷 분포(빈 버킷 비율, 최대 체인 길이, 평균 탐색 길이, 체인 길이 히스토그램)를 출력.
   */
  void process_hash_command(char **cmd_tokens, int token_count) {
      if (token_count < 2)
@@ -465,7 +664,7 @@
          int value_to_delete = atoi(cmd_tokens[2]);
          struct hash_node tmp_node;
          tmp_node.num_value = value_to_delete;
-         hash_delete(hashTbl, (struct hash_elem *)&tmp_node.hash_link);
+         hash_delete(hashTbl, &tmp_node.hash_link);
      }
      else if (strcmp(cmd_tokens[0], "hash_empty") == 0) {
          printf("%s\n", hash_empty(hashTbl) ? "true" : "false");
@@ -476,7 +675,7 @@
          struct hash_node tmp_node;
          memset(&tmp_node, 0, sizeof(tmp_node));
          tmp_node.num_value = search_val;
-         struct hash_elem *found_elem = hash_find(hashTbl, (struct hash_elem *)&tmp_node.hash_link);
+         struct hash_elem *found_elem = hash_find(hashTbl, &tmp_node.hash_link);
          if (found_elem)
              printf("%d\n", hash_entry(found_elem, struct hash_node, hash_link)->num_value);
          fflush(stdout);
@@ -485,18 +684,31 @@
          int insert_val = atoi(cmd_tokens[2]);
          struct hash_node *new_node = malloc(sizeof(struct hash_node));
          new_node->num_value = insert_val;
-         hash_insert(hashTbl, (struct hash_elem *)&new_node->hash_link);
+         hash_insert(hashTbl, &new_node->hash_link);
      }
      else if (strcmp(cmd_tokens[0], "hash_replace") == 0 && token_count >= 3) {
          int replace_val = atoi(cmd_tokens[2]);
          struct hash_node *new_node = malloc(sizeof(struct hash_node));
          new_node->num_value = replace_val;
-         hash_replace(hashTbl, (struct hash_elem *)&new_node->hash_link);
+         hash_replace(hashTbl, &new_node->hash_link);
      }
      else if (strcmp(cmd_tokens[0], "hash_size") == 0) {
          printf("%zu\n", hash_size(hashTbl));
          fflush(stdout);
      }
+     else if (strcmp(cmd_tokens[0], "hash_stats") == 0) {
+         struct hash_stats stats;
+         hash_get_stats(hashTbl, &stats);
+         printf("buckets %zu, elems %zu, empty %.3f, max %zu, avg_probe %.3f\n",
+                stats.bucket_cnt, hash_size(hashTbl),
+                stats.bucket_cnt ? (double)stats.empty_cnt / stats.bucket_cnt : 0.0,
+                stats.max_len, stats.avg_probe);
+         // 마지막 칸은 그 이상의 길이를 모두 포함
+         for (int i = 0; i < HASH_STATS_HIST; i++)
+             printf("%d%s:%zu ", i, i == HASH_STATS_HIST - 1 ? "+" : "", stats.histogram[i]);
+         printf("\n");
+         fflush(stdout);
+     }
  }
  
  /*
@@ -657,6 +869,80 @@
      }
  }
  
+ /*
+  * process_cbitmap_command:
+  *   - 압축 비트맵에 대한 비트맵 명령어 처리.
+  *   - process_bitmap_command와 같은 명령어를 같은 출력 형식으로 지원.
+  */
+ void process_cbitmap_command(struct cbitmap *cbmp, char **cmd_tokens, int token_count) {
+     const char *cmd = cmd_tokens[0];
+     size_t start_idx = token_count >= 3 ? (size_t)atoi(cmd_tokens[2]) : 0;
+     size_t count_val = token_count >= 4 ? (size_t)atoi(cmd_tokens[3]) : 0;
+     bool bool_val;
+ 
+     if (strcmp(cmd, "bitmap_all") == 0 && token_count >= 4) {
+         printf("%s\n", cbitmap_all(cbmp, start_idx, count_val) ? "true" : "false");
+     }
+     else if (strcmp(cmd, "bitmap_any") == 0 && token_count >= 4) {
+         printf("%s\n", cbitmap_any(cbmp, start_idx, count_val) ? "true" : "false");
+     }
+     else if (strcmp(cmd, "bitmap_contains") == 0 && token_count >= 5) {
+         if (!parse_bool_token(cmd_tokens[4], &bool_val))
+             return;
+         printf("%s\n", cbitmap_contains(cbmp, start_idx, count_val, bool_val) ? "true" : "false");
+     }
+     else if (strcmp(cmd, "bitmap_count") == 0 && token_count >= 5) {
+         bool_val = (strcmp(cmd_tokens[4], "true") == 0);
+         printf("%zu\n", cbitmap_count(cbmp, start_idx, count_val, bool_val));
+     }
+     else if (strcmp(cmd, "bitmap_dump") == 0) {
+         cbitmap_dump(cbmp);
+     }
+     else if (strcmp(cmd, "bitmap_expand") == 0 && token_count >= 3) {
+         cbitmap_resize(cbmp, cbitmap_size(cbmp) + start_idx);
+     }
+     else if (strcmp(cmd, "bitmap_flip") == 0 && token_count >= 3) {
+         cbitmap_flip(cbmp, start_idx);
+     }
+     else if (strcmp(cmd, "bitmap_mark") == 0 && token_count >= 3) {
+         cbitmap_mark(cbmp, start_idx);
+     }
+     else if (strcmp(cmd, "bitmap_none") == 0 && token_count >= 4) {
+         printf("%s\n", cbitmap_none(cbmp, start_idx, count_val) ? "true" : "false");
+     }
+     else if (strcmp(cmd, "bitmap_reset") == 0 && token_count >= 3) {
+         cbitmap_reset(cbmp, start_idx);
+     }
+     else if ((strcmp(cmd, "bitmap_scan") == 0 || strcmp(cmd, "bitmap_scan_and_flip") == 0)
+              && token_count >= 5) {
+         if (!parse_bool_token(cmd_tokens[4], &bool_val))
+             return;
+         size_t index_found = strcmp(cmd, "bitmap_scan") == 0
+             ? cbitmap_scan(cbmp, start_idx, count_val, bool_val)
+             : cbitmap_scan_and_flip(cbmp, start_idx, count_val, bool_val);
+         if (index_found == BITMAP_ERROR)
+             printf("%llu\n", (unsigned long long)BITMAP_ERROR);
+         else
+             printf("%zu\n", index_found);
+     }
+     else if (strcmp(cmd, "bitmap_set") == 0 && token_count >= 4) {
+         cbitmap_set(cbmp, start_idx, strcmp(cmd_tokens[3], "true") == 0);
+     }
+     else if (strcmp(cmd, "bitmap_set_all") == 0 && token_count >= 3) {
+         cbitmap_set_all(cbmp, strcmp(cmd_tokens[2], "true") == 0);
+     }
+     else if (strcmp(cmd, "bitmap_set_multiple") == 0 && token_count >= 5) {
+         cbitmap_set_multiple(cbmp, start_idx, count_val, strcmp(cmd_tokens[4], "true") == 0);
+     }
+     else if (strcmp(cmd, "bitmap_size") == 0) {
+         printf("%zu\n", cbitmap_size(cbmp));
+     }
+     else if (strcmp(cmd, "bitmap_test") == 0 && token_count >= 3) {
+         printf("%s\n", cbitmap_test(cbmp, start_idx) ? "true" : "false");
+     }
+     fflush(stdout);
+ }
+ 
  /*
   * process_bitmap_command:
   *   - 비트맵 관련 명령어 처리.
@@ -668,8 +954,13 @@
      if (token_count < 2)
          return;
      int index = extract_index_from_name(cmd_tokens[1]);
-     if (index < 0 || index >= MAX_OBJECTS || bmp_arr[index] == NULL)
+     if (index < 0 || index >= MAX_OBJECTS)
          return;
+     if (bmp_arr[index] == NULL) {
+         if (cbmp_arr[index] != NULL)
+             process_cbitmap_command(cbmp_arr[index], cmd_tokens, token_count);
+         return;
+     }
      struct bitmap *bmp = bmp_arr[index];
  
      if (strcmp(cmd_tokens[0], "bitmap_all") == 0 && token_count >= 4) {
@@ -815,6 +1106,72 @@
      }
  }
  
+ /*
+  * process_buddy_command:
+  *   - 버디 할당자 관련 명령어 처리.
+  *   - buddy_alloc (할당한 블록의 시작 위치 출력), buddy_free, buddy_available, buddy_size 등.
+  */
+ void process_buddy_command(char **cmd_tokens, int token_count) {
+     if (token_count < 2)
+         return;
+     int index = extract_index_from_name(cmd_tokens[1]);
+     if (index < 0 || index >= MAX_OBJECTS || buddy_arr[index] == NULL)
+         return;
+     struct buddy *allocator = buddy_arr[index];
+ 
+     if (strcmp(cmd_tokens[0], "buddy_alloc") == 0 && token_count >= 3) {
+         size_t size = (size_t)atol(cmd_tokens[2]);
+         size_t block_start = buddy_alloc(allocator, size);
+         if (block_start == BITMAP_ERROR)
+             printf("%llu\n", (unsigned long long)BITMAP_ERROR);
+         else
+             printf("%zu\n", block_start);
+     }
+     else if (strcmp(cmd_tokens[0], "buddy_free") == 0 && token_count >= 3) {
+         size_t block_start = (size_t)atol(cmd_tokens[2]);
+         if (buddy_block_size(allocator, block_start) == 0) {
+             printf("Invalid block.\n");
+             return;
+         }
+         buddy_free(allocator, block_start);
+     }
+     else if (strcmp(cmd_tokens[0], "buddy_available") == 0) {
+         printf("%zu\n", buddy_available(allocator));
+     }
+     else if (strcmp(cmd_tokens[0], "buddy_size") == 0) {
+         printf("%zu\n", buddy_size(allocator));
+     }
+     fflush(stdout);
+ }
+ 
+ /*
+  * process_bloom_command:
+  *   - 블룸 필터 관련 명령어 처리.
+  *   - bloom_insert, bloom_query (있을 수 있으면 true, 확실히 없으면 false), bloom_clear, bloom_size 등.
+  */
+ void process_bloom_command(char **cmd_tokens, int token_count) {
+     if (token_count < 2)
+         return;
+     int index = extract_index_from_name(cmd_tokens[1]);
+     if (index < 0 || index >= MAX_OBJECTS || bloom_arr[index] == NULL)
+         return;
+     struct bloom *filter = bloom_arr[index];
+ 
+     if (strcmp(cmd_tokens[0], "bloom_insert") == 0 && token_count >= 3) {
+         bloom_insert_int(filter, atoi(cmd_tokens[2]));
+     }
+     else if (strcmp(cmd_tokens[0], "bloom_query") == 0 && token_count >= 3) {
+         printf("%s\n", bloom_query_int(filter, atoi(cmd_tokens[2])) ? "true" : "false");
+     }
+     else if (strcmp(cmd_tokens[0], "bloom_clear") == 0) {
+         bloom_clear(filter);
+     }
+     else if (strcmp(cmd_tokens[0], "bloom_size") == 0) {
+         printf("%zu\n", bloom_size(filter));
+     }
+     fflush(stdout);
+ }
+ 
  /* ---------------------- */
  /*          main         */
  /* ---------------------- */
@@ -825,6 +1182,9 @@
          list_arr[idx] = NULL;
          hash_arr[idx] = NULL;
          bmp_arr[idx] = NULL;
+         cbmp_arr[idx] = NULL;
+         buddy_arr[idx] = NULL;
+         bloom_arr[idx] = NULL;
      }
  
      char inputBuffer[MAX_INPUT_LENGTH];
@@ -849,6 +1209,10 @@
              process_list_command(cmdTokens, numTokens);
          else if (strncmp(cmdTokens[0], "bitmap_", 7) == 0)
              process_bitmap_command(cmdTokens, numTokens);
+         else if (strncmp(cmdTokens[0], "buddy_", 6) == 0)
+             process_buddy_command(cmdTokens, numTokens);
+         else if (strncmp(cmdTokens[0], "bloom_", 6) == 0)
+             process_bloom_command(cmdTokens, numTokens);
      }
      return 0;
  }
@@ -0,0 +1,763 @@
+/* Vectorized kernels for bulk loops.
+
+   See simd.h for basic information.
+
+   Each level provides a full set of kernels in a `struct
+   simd_ops'.  Kernels for levels above the compiler's baseline
+   are compiled with GCC's `target' attribute, so this file needs
+   no special compiler options, and they are only ever called
+   after CPUID has confirmed that the CPU supports them.  Each
+   vector loop finishes the last few elements of an array with
+   scalar code. */
+
+#include "simd.h"
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+#define ASSERT(CONDITION) assert(CONDITION)
+
+/* Kernels for one level. */
+struct simd_ops
+  {
+    size_t (*popcount) (const unsigned long *, size_t);
+    size_t (*popcount_and) (const unsigned long *, const unsigned long *,
+                            size_t);
+    void (*fill) (unsigned long *, size_t, unsigned long);
+    size_t (*find_ne) (const unsigned long *, size_t, unsigned long);
+    bool (*intersects) (const unsigned long *, const unsigned long *,
+                        size_t);
+    void (*binop) (enum simd_op, unsigned long *, const unsigned long *,
+                   const unsigned long *, size_t);
+    unsigned (*match_byte) (const unsigned char *, unsigned char);
+    unsigned (*crc32c) (const unsigned char *, size_t, unsigned);
+  };
+
+/* Returns OP applied to A and B. */
+static inline unsigned long
+scalar_op (enum simd_op op, unsigned long a, unsigned long b)
+{
+  switch (op)
+    {
+    case SIMD_AND:
+      return a & b;
+    case SIMD_OR:
+      return a | b;
+    case SIMD_XOR:
+      return a ^ b;
+    default:
+      return a & ~b;
+    }
+}
+
+/* Portable kernels. */
+
+static size_t
+scalar_popcount (const unsigned long *a, size_t cnt)
+{
+  size_t i, total = 0;
+
+  for (i = 0; i < cnt; i++)
+    total += __builtin_popcountl (a[i]);
+  return total;
+}
+
+static size_t
+scalar_popcount_and (const unsigned long *a, const unsigned long *b,
+                     size_t cnt)
+{
+  size_t i, total = 0;
+
+  for (i = 0; i < cnt; i++)
+    total += __builtin_popcountl (a[i] & b[i]);
+  return total;
+}
+
+static void
+scalar_fill (unsigned long *a, size_t cnt, unsigned long value)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    a[i] = value;
+}
+
+static size_t
+scalar_find_ne (const unsigned long *a, size_t cnt, unsigned long value)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    if (a[i] != value)
+      break;
+  return i;
+}
+
+static bool
+scalar_intersects (const unsigned long *a, const unsigned long *b, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    if ((a[i] & b[i]) != 0)
+      return true;
+  return false;
+}
+
+static void
+scalar_binop (enum simd_op op, unsigned long *dst, const unsigned long *a,
+              const unsigned long *b, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    dst[i] = scalar_op (op, a[i], b[i]);
+}
+
+static unsigned
+scalar_match_byte (const unsigned char *group, unsigned char byte)
+{
+  unsigned mask = 0;
+  int i;
+
+  for (i = 0; i < SIMD_GROUP; i++)
+    if (group[i] == byte)
+      mask |= 1u << i;
+  return mask;
+}
+
+/* CRC-32C (Castagnoli) polynomial, bit-reversed. */
+#define CRC32C_POLY 0x82f63b78u
+
+/* CRC-32C of each byte value, filled in by simd_init(). */
+static unsigned crc32c_table[256];
+
+/* Fills in crc32c_table. */
+static void
+crc32c_init (void)
+{
+  unsigned i;
+  int j;
+
+  for (i = 0; i < 256; i++)
+    {
+      unsigned crc = i;
+      for (j = 0; j < 8; j++)
+        crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+      crc32c_table[i] = crc;
+    }
+}
+
+static unsigned
+scalar_crc32c (const unsigned char *buf, size_t size, unsigned crc)
+{
+  while (size-- > 0)
+    crc = (crc >> 8) ^ crc32c_table[(crc ^ *buf++) & 0xff];
+  return crc;
+}
+
+static const struct simd_ops scalar_ops =
+  {
+    scalar_popcount, scalar_popcount_and, scalar_fill, scalar_find_ne,
+    scalar_intersects, scalar_binop, scalar_match_byte, scalar_crc32c
+  };
+
+#ifdef __x86_64__
+#define TARGET_SSE2 __attribute__ ((target ("sse2")))
+#define TARGET_SSE42 __attribute__ ((target ("sse4.2")))
+#define TARGET_AVX2 __attribute__ ((target ("avx2")))
+#define TARGET_AVX512 \
+        __attribute__ ((target ("avx512f,avx512vpopcntdq")))
+
+/* SSE2 kernels.  Two elements per vector. */
+
+/* Loads two elements from P, which need not be aligned. */
+static inline TARGET_SSE2 __m128i
+sse2_load (const unsigned long *p)
+{
+  return _mm_loadu_si128 ((const __m128i *) p);
+}
+
+/* Returns the population counts of the two 64-bit lanes of V,
+   computed with the classic shift-and-mask reduction followed by
+   a sum of absolute differences against zero. */
+static inline TARGET_SSE2 __m128i
+sse2_popcnt (__m128i v)
+{
+  const __m128i m1 = _mm_set1_epi8 (0x55);
+  const __m128i m2 = _mm_set1_epi8 (0x33);
+  const __m128i m4 = _mm_set1_epi8 (0x0f);
+
+  v = _mm_sub_epi8 (v, _mm_and_si128 (_mm_srli_epi64 (v, 1), m1));
+  v = _mm_add_epi8 (_mm_and_si128 (v, m2),
+                    _mm_and_si128 (_mm_srli_epi64 (v, 2), m2));
+  v = _mm_and_si128 (_mm_add_epi8 (v, _mm_srli_epi64 (v, 4)), m4);
+  return _mm_sad_epu8 (v, _mm_setzero_si128 ());
+}
+
+/* Returns the sum of the two 64-bit lanes of V. */
+static inline TARGET_SSE2 size_t
+sse2_sum (__m128i v)
+{
+  return _mm_cvtsi128_si64 (v)
+         + _mm_cvtsi128_si64 (_mm_unpackhi_epi64 (v, v));
+}
+
+static TARGET_SSE2 size_t
+sse2_popcount (const unsigned long *a, size_t cnt)
+{
+  __m128i acc = _mm_setzero_si128 ();
+  size_t i;
+
+  for (i = 0; i + 2 <= cnt; i += 2)
+    acc = _mm_add_epi64 (acc, sse2_popcnt (sse2_load (a + i)));
+  return sse2_sum (acc) + scalar_popcount (a + i, cnt - i);
+}
+
+static TARGET_SSE2 size_t
+sse2_popcount_and (const unsigned long *a, const unsigned long *b, size_t cnt)
+{
+  __m128i acc = _mm_setzero_si128 ();
+  size_t i;
+
+  for (i = 0; i + 2 <= cnt; i += 2)
+    {
+      __m128i x = _mm_and_si128 (sse2_load (a + i), sse2_load (b + i));
+      acc = _mm_add_epi64 (acc, sse2_popcnt (x));
+    }
+  return sse2_sum (acc) + scalar_popcount_and (a + i, b + i, cnt - i);
+}
+
+static TARGET_SSE2 void
+sse2_fill (unsigned long *a, size_t cnt, unsigned long value)
+{
+  __m128i v = _mm_set1_epi64x (value);
+  size_t i;
+
+  for (i = 0; i + 2 <= cnt; i += 2)
+    _mm_storeu_si128 ((__m128i *) (a + i), v);
+  scalar_fill (a + i, cnt - i, value);
+}
+
+static TARGET_SSE2 size_t
+sse2_find_ne (const unsigned long *a, size_t cnt, unsigned long value)
+{
+  __m128i v = _mm_set1_epi64x (value);
+  size_t i;
+
+  /* SSE2 has no 64-bit compare, but two elements are equal
+     exactly when both of their 32-bit halves are. */
+  for (i = 0; i + 2 <= cnt; i += 2)
+    {
+      __m128i eq = _mm_cmpeq_epi32 (sse2_load (a + i), v);
+      if (_mm_movemask_epi8 (eq) != 0xffff)
+        break;
+    }
+  return i + scalar_find_ne (a + i, cnt - i, value);
+}
+
+static TARGET_SSE2 bool
+sse2_intersects (const unsigned long *a, const unsigned long *b, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i + 2 <= cnt; i += 2)
+    {
+      __m128i x = _mm_and_si128 (sse2_load (a + i), sse2_load (b + i));
+      if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (x, _mm_setzero_si128 ()))
+          != 0xffff)
+        return true;
+    }
+  return scalar_intersects (a + i, b + i, cnt - i);
+}
+
+static TARGET_SSE2 void
+sse2_binop (enum simd_op op, unsigned long *dst, const unsigned long *a,
+            const unsigned long *b, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i + 2 <= cnt; i += 2)
+    {
+      __m128i x = sse2_load (a + i);
+      __m128i y = sse2_load (b + i);
+      switch (op)
+        {
+        case SIMD_AND:
+          x = _mm_and_si128 (x, y);
+          break;
+        case SIMD_OR:
+          x = _mm_or_si128 (x, y);
+          break;
+        case SIMD_XOR:
+          x = _mm_xor_si128 (x, y);
+          break;
+        default:
+          x = _mm_andnot_si128 (y, x);
+          break;
+        }
+      _mm_storeu_si128 ((__m128i *) (dst + i), x);
+    }
+  scalar_binop (op, dst + i, a + i, b + i, cnt - i);
+}
+
+/* A group of control bytes is exactly one SSE2 vector, so the
+   higher levels use this kernel too. */
+static TARGET_SSE2 unsigned
+sse2_match_byte (const unsigned char *group, unsigned char byte)
+{
+  __m128i x = _mm_loadu_si128 ((const __m128i *) group);
+  return _mm_movemask_epi8 (_mm_cmpeq_epi8 (x, _mm_set1_epi8 (byte)));
+}
+
+static const struct simd_ops sse2_ops =
+  {
+    sse2_popcount, sse2_popcount_and, sse2_fill, sse2_find_ne,
+    sse2_intersects, sse2_binop, sse2_match_byte, scalar_crc32c
+  };
+
+/* The CRC32 instruction came with SSE4.2, which is not part of
+   the SSE2 level, but every CPU with AVX2 has it, so the higher
+   levels use this kernel.  It consumes eight bytes per
+   instruction. */
+static TARGET_SSE42 unsigned
+sse42_crc32c (const unsigned char *buf, size_t size, unsigned crc)
+{
+  uint64_t crc64 = crc;
+
+  for (; size >= 8; size -= 8, buf += 8)
+    {
+      uint64_t word;
+      memcpy (&word, buf, sizeof word);
+      crc64 = _mm_crc32_u64 (crc64, word);
+    }
+  crc = crc64;
+  while (size-- > 0)
+    crc = _mm_crc32_u8 (crc, *buf++);
+  return crc;
+}
+
+/* AVX2 kernels.  Four elements per vector. */
+
+/* Loads four elements from P, which need not be aligned. */
+static inline TARGET_AVX2 __m256i
+avx2_load (const unsigned long *p)
+{
+  return _mm256_loadu_si256 ((const __m256i *) p);
+}
+
+/* Returns the population counts of the four 64-bit lanes of V.
+   Looks up the count of each nibble in a 16-entry table with
+   VPSHUFB, then sums the bytes of each lane with VPSADBW. */
+static inline TARGET_AVX2 __m256i
+avx2_popcnt (__m256i v)
+{
+  const __m256i table = _mm256_setr_epi8 (0, 1, 1, 2, 1, 2, 2, 3,
+                                          1, 2, 2, 3, 2, 3, 3, 4,
+                                          0, 1, 1, 2, 1, 2, 2, 3,
+                                          1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8 (0x0f);
+  __m256i lo = _mm256_and_si256 (v, low);
+  __m256i hi = _mm256_and_si256 (_mm256_srli_epi16 (v, 4), low);
+  __m256i cnt = _mm256_add_epi8 (_mm256_shuffle_epi8 (table, lo),
+                                 _mm256_shuffle_epi8 (table, hi));
+  return _mm256_sad_epu8 (cnt, _mm256_setzero_si256 ());
+}
+
+/* Returns the sum of the four 64-bit lanes of V. */
+static inline TARGET_AVX2 size_t
+avx2_sum (__m256i v)
+{
+  __m128i x = _mm_add_epi64 (_mm256_castsi256_si128 (v),
+                             _mm256_extracti128_si256 (v, 1));
+  return _mm_cvtsi128_si64 (x) + _mm_extract_epi64 (x, 1);
+}
+
+static TARGET_AVX2 size_t
+avx2_popcount (const unsigned long *a, size_t cnt)
+{
+  __m256i acc = _mm256_setzero_si256 ();
+  size_t i;
+
+  for (i = 0; i + 4 <= cnt; i += 4)
+    acc = _mm256_add_epi64 (acc, avx2_popcnt (avx2_load (a + i)));
+  return avx2_sum (acc) + scalar_popcount (a + i, cnt - i);
+}
+
+static TARGET_AVX2 size_t
+avx2_popcount_and (const unsigned long *a, const unsigned long *b, size_t cnt)
+{
+  __m256i acc = _mm256_setzero_si256 ();
+  size_t i;
+
+  for (i = 0; i + 4 <= cnt; i += 4)
+    {
+      __m256i x = _mm256_and_si256 (avx2_load (a + i), avx2_load (b + i));
+      acc = _mm256_add_epi64 (acc, avx2_popcnt (x));
+    }
+  return avx2_sum (acc) + scalar_popcount_and (a + i, b + i, cnt - i);
+}
+
+static TARGET_AVX2 void
+avx2_fill (unsigned long *a, size_t cnt, unsigned long value)
+{
+  __m256i v = _mm256_set1_epi64x (value);
+  size_t i;
+
+  for (i = 0; i + 4 <= cnt; i += 4)
+    _mm256_storeu_si256 ((__m256i *) (a + i), v);
+  scalar_fill (a + i, cnt - i, value);
+}
+
+static TARGET_AVX2 size_t
+avx2_find_ne (const unsigned long *a, size_t cnt, unsigned long value)
+{
+  __m256i v = _mm256_set1_epi64x (value);
+  size_t i;
+
+  for (i = 0; i + 4 <= cnt; i += 4)
+    {
+      __m256i eq = _mm256_cmpeq_epi64 (avx2_load (a + i), v);
+      if (_mm256_movemask_epi8 (eq) != -1)
+        break;
+    }
+  return i + scalar_find_ne (a + i, cnt - i, value);
+}
+
+static TARGET_AVX2 bool
+avx2_intersects (const unsigned long *a, const unsigned long *b, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i + 4 <= cnt; i += 4)
+    if (!_mm256_testz_si256 (avx2_load (a + i), avx2_load (b + i)))
+      return true;
+  return scalar_intersects (a + i, b + i, cnt - i);
+}
+
+static TARGET_AVX2 void
+avx2_binop (enum simd_op op, unsigned long *dst, const unsigned long *a,
+            const unsigned long *b, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i + 4 <= cnt; i += 4)
+    {
+      __m256i x = avx2_load (a + i);
+      __m256i y = avx2_load (b + i);
+      switch (op)
+        {
+        case SIMD_AND:
+          x = _mm256_and_si256 (x, y);
+          break;
+        case SIMD_OR:
+          x = _mm256_or_si256 (x, y);
+          break;
+        case SIMD_XOR:
+          x = _mm256_xor_si256 (x, y);
+          break;
+        default:
+          x = _mm256_andnot_si256 (y, x);
+          break;
+        }
+      _mm256_storeu_si256 ((__m256i *) (dst + i), x);
+    }
+  scalar_binop (op, dst + i, a + i, b + i, cnt - i);
+}
+
+static const struct simd_ops avx2_ops =
+  {
+    avx2_popcount, avx2_popcount_and, avx2_fill, avx2_find_ne,
+    avx2_intersects, avx2_binop, sse2_match_byte, sse42_crc32c
+  };
+
+/* AVX-512 kernels.  Eight elements per vector. */
+
+static TARGET_AVX512 size_t
+avx512_popcount (const unsigned long *a, size_t cnt)
+{
+  __m512i acc = _mm512_setzero_si512 ();
+  size_t i;
+
+  for (i = 0; i + 8 <= cnt; i += 8)
+    acc = _mm512_add_epi64 (acc,
+                            _mm512_popcnt_epi64 (_mm512_loadu_si512 (a + i)));
+  return _mm512_reduce_add_epi64 (acc) + scalar_popcount (a + i, cnt - i);
+}
+
+static TARGET_AVX512 size_t
+avx512_popcount_and (const unsigned long *a, const unsigned long *b,
+                     size_t cnt)
+{
+  __m512i acc = _mm512_setzero_si512 ();
+  size_t i;
+
+  for (i = 0; i + 8 <= cnt; i += 8)
+    {
+      __m512i x = _mm512_and_si512 (_mm512_loadu_si512 (a + i),
+                                    _mm512_loadu_si512 (b + i));
+      acc = _mm512_add_epi64 (acc, _mm512_popcnt_epi64 (x));
+    }
+  return (_mm512_reduce_add_epi64 (acc)
+          + scalar_popcount_and (a + i, b + i, cnt - i));
+}
+
+static TARGET_AVX512 void
+avx512_fill (unsigned long *a, size_t cnt, unsigned long value)
+{
+  __m512i v = _mm512_set1_epi64 (value);
+  size_t i;
+
+  for (i = 0; i + 8 <= cnt; i += 8)
+    _mm512_storeu_si512 (a + i, v);
+  scalar_fill (a + i, cnt - i, value);
+}
+
+static TARGET_AVX512 size_t
+avx512_find_ne (const unsigned long *a, size_t cnt, unsigned long value)
+{
+  __m512i v = _mm512_set1_epi64 (value);
+  size_t i;
+
+  for (i = 0; i + 8 <= cnt; i += 8)
+    {
+      __mmask8 ne = _mm512_cmpneq_epi64_mask (_mm512_loadu_si512 (a + i), v);
+      if (ne != 0)
+        return i + __builtin_ctz (ne);
+    }
+  return i + scalar_find_ne (a + i, cnt - i, value);
+}
+
+static TARGET_AVX512 bool
+avx512_intersects (const unsigned long *a, const unsigned long *b,
+                   size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i + 8 <= cnt; i += 8)
+    if (_mm512_test_epi64_mask (_mm512_loadu_si512 (a + i),
+                                _mm512_loadu_si512 (b + i)) != 0)
+      return true;
+  return scalar_intersects (a + i, b + i, cnt - i);
+}
+
+static TARGET_AVX512 void
+avx512_binop (enum simd_op op, unsigned long *dst, const unsigned long *a,
+              const unsigned long *b, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i + 8 <= cnt; i += 8)
+    {
+      __m512i x = _mm512_loadu_si512 (a + i);
+      __m512i y = _mm512_loadu_si512 (b + i);
+      switch (op)
+        {
+        case SIMD_AND:
+          x = _mm512_and_si512 (x, y);
+          break;
+        case SIMD_OR:
+          x = _mm512_or_si512 (x, y);
+          break;
+        case SIMD_XOR:
+          x = _mm512_xor_si512 (x, y);
+          break;
+        default:
+          x = _mm512_andnot_si512 (y, x);
+          break;
+        }
+      _mm512_storeu_si512 (dst + i, x);
+    }
+  scalar_binop (op, dst + i, a + i, b + i, cnt - i);
+}
+
+static const struct simd_ops avx512_ops =
+  {
+    avx512_popcount, avx512_popcount_and, avx512_fill, avx512_find_ne,
+    avx512_intersects, avx512_binop, sse2_match_byte, sse42_crc32c
+  };
+#endif /* __x86_64__ */
+
+/* Kernels for each level, or a null pointer for a level that
+   this build does not provide. */
+static const struct simd_ops *const level_ops[SIMD_LEVEL_CNT] =
+  {
+    &scalar_ops,
+#ifdef __x86_64__
+    &sse2_ops, &avx2_ops, &avx512_ops
+#endif
+  };
+
+/* Currently selected level and its kernels. */
+static enum simd_level cur_level = SIMD_SCALAR;
+static const struct simd_ops *ops = &scalar_ops;
+
+/* Returns true if the CPU we are running on supports LEVEL. */
+static bool
+cpu_supports (enum simd_level level)
+{
+  if (level_ops[level] == NULL)
+    return false;
+#ifdef __x86_64__
+  __builtin_cpu_init ();
+  switch (level)
+    {
+    case SIMD_SCALAR:
+    case SIMD_SSE2:
+      return true;
+    case SIMD_AVX2:
+      return (__builtin_cpu_supports ("avx2")
+              && __builtin_cpu_supports ("sse4.2"));
+    case SIMD_AVX512:
+      return (__builtin_cpu_supports ("avx512f")
+              && __builtin_cpu_supports ("avx512vpopcntdq"));
+    default:
+      return false;
+    }
+#else
+  return level == SIMD_SCALAR;
+#endif
+}
+
+/* Selects the best level that the CPU supports.  Runs once,
+   before main(). */
+static void __attribute__ ((constructor))
+simd_init (void)
+{
+  int level;
+
+  crc32c_init ();
+  for (level = SIMD_LEVEL_CNT - 1; level > SIMD_SCALAR; level--)
+    if (simd_select (level))
+      return;
+}
+
+/* Returns the currently selected level. */
+enum simd_level
+simd_level (void)
+{
+  return cur_level;
+}
+
+/* Returns a name for LEVEL, for use in messages. */
+const char *
+simd_level_name (enum simd_level level)
+{
+  static const char *names[SIMD_LEVEL_CNT] =
+    { "scalar", "sse2", "avx2", "avx512" };
+
+  ASSERT (level < SIMD_LEVEL_CNT);
+  return names[level];
+}
+
+/* Switches to the kernels for LEVEL, if the CPU supports it, and
+   returns true.  Returns false and keeps the current kernels
+   otherwise.  Meant for comparing levels in benchmarks and must
+   not be called while other threads are using the kernels. */
+bool
+simd_select (enum simd_level level)
+{
+  ASSERT (level < SIMD_LEVEL_CNT);
+  if (!cpu_supports (level))
+    return false;
+  cur_level = level;
+  ops = level_ops[level];
+  return true;
+}
+
+/* Returns the number of 1 bits in the CNT elements of A. */
+size_t
+simd_popcount (const unsigned long *a, size_t cnt)
+{
+  return ops->popcount (a, cnt);
+}
+
+/* Returns the number of 1 bits in A[i] & B[i], summed over the
+   CNT elements of A and B. */
+size_t
+simd_popcount_and (const unsigned long *a, const unsigned long *b,
+                   size_t cnt)
+{
+  return ops->popcount_and (a, b, cnt);
+}
+
+/* Sets each of the CNT elements of A to VALUE. */
+void
+simd_fill (unsigned long *a, size_t cnt, unsigned long value)
+{
+  ops->fill (a, cnt, value);
+}
+
+/* Returns the index of the first of the CNT elements of A that
+   differs from VALUE, or CNT if all of them equal VALUE. */
+size_t
+simd_find_ne (const unsigned long *a, size_t cnt, unsigned long value)
+{
+  return ops->find_ne (a, cnt, value);
+}
+
+/* Returns true if A[i] & B[i] is nonzero for some i less than
+   CNT, false otherwise. */
+bool
+simd_intersects (const unsigned long *a, const unsigned long *b, size_t cnt)
+{
+  return ops->intersects (a, b, cnt);
+}
+
+/* Sets DST[i] to A[i] OP B[i] for each i less than CNT.  DST may
+   be A or B. */
+void
+simd_binop (enum simd_op op, unsigned long *dst, const unsigned long *a,
+            const unsigned long *b, size_t cnt)
+{
+  ops->binop (op, dst, a, b, cnt);
+}
+
+/* Returns a mask in which bit I is set if GROUP[I] equals BYTE,
+   for each I less than SIMD_GROUP. */
+unsigned
+simd_match_byte (const unsigned char *group, unsigned char byte)
+{
+  return ops->match_byte (group, byte);
+}
+
+/* Returns the CRC-32C of the SIZE bytes in BUF, continuing from
+   CRC, without the customary inversion before and after, which
+   is left to the caller. */
+unsigned
+simd_crc32c (const void *buf, size_t size, unsigned crc)
+{
+  ASSERT (buf != NULL || size == 0);
+  return ops->crc32c (buf, size, crc);
+}
+
+/* Returns the Fowler-Noll-Vo FNV-1 hash of the SIZE bytes in
+   BUF, starting from BASIS and multiplying by PRIME.
+
+   Each step multiplies the hash of all the previous bytes, so
+   the loop is a serial chain that no vector unit can shorten
+   without changing the result.  Every level therefore shares
+   this unrolled scalar loop, which at least keeps the loop
+   overhead off the critical path. */
+unsigned
+simd_fnv1 (const void *buf_, size_t size, unsigned basis, unsigned prime)
+{
+  const unsigned char *buf = buf_;
+  unsigned hash = basis;
+
+  ASSERT (buf != NULL);
+
+  for (; size >= 4; size -= 4, buf += 4)
+    {
+      hash = (hash * prime) ^ buf[0];
+      hash = (hash * prime) ^ buf[1];
+      hash = (hash * prime) ^ buf[2];
+      hash = (hash * prime) ^ buf[3];
+    }
+  while (size-- > 0)
+    hash = (hash * prime) ^ *buf++;
+  return hash;
+}
@@ -0,0 +1,63 @@
+#ifndef __MYLIB_SIMD_H
+#define __MYLIB_SIMD_H
+
+/* Vectorized kernels for bulk loops.
+
+   The bulk loops of the bitmap and hash modules call through
+   this interface, which dispatches to SSE2, AVX2, or AVX-512
+   implementations, or to portable C.  The best level that the
+   CPU supports is chosen once at startup by querying CPUID.
+
+   The array kernels operate on arrays of unsigned long, which
+   is the element type used inside bitmap.c.  The group kernel
+   operates on the control bytes of open-addressing hash tables,
+   SIMD_GROUP bytes at a time. */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Implementation levels, in increasing order of capability. */
+enum simd_level
+  {
+    SIMD_SCALAR,                /* Portable C. */
+    SIMD_SSE2,                  /* 128-bit SSE2. */
+    SIMD_AVX2,                  /* 256-bit AVX2. */
+    SIMD_AVX512,                /* 512-bit AVX-512F with VPOPCNTDQ. */
+    SIMD_LEVEL_CNT
+  };
+
+/* Element-wise binary operations for simd_binop(). */
+enum simd_op
+  {
+    SIMD_AND,                   /* A & B. */
+    SIMD_OR,                    /* A | B. */
+    SIMD_XOR,                   /* A ^ B. */
+    SIMD_ANDNOT                 /* A & ~B. */
+  };
+
+/* Implementation selection. */
+enum simd_level simd_level (void);
+const char *simd_level_name (enum simd_level);
+bool simd_select (enum simd_level);
+
+/* Array kernels. */
+size_t simd_popcount (const unsigned long *, size_t cnt);
+size_t simd_popcount_and (const unsigned long *, const unsigned long *,
+                          size_t cnt);
+void simd_fill (unsigned long *, size_t cnt, unsigned long value);
+size_t simd_find_ne (const unsigned long *, size_t cnt, unsigned long value);
+bool simd_intersects (const unsigned long *, const unsigned long *,
+                      size_t cnt);
+void simd_binop (enum simd_op, unsigned long *dst, const unsigned long *,
+                 const unsigned long *, size_t cnt);
+
+/* Group kernels. */
+#define SIMD_GROUP 16
+unsigned simd_match_byte (const unsigned char *group, unsigned char byte);
+
+/* Hashing kernels. */
+unsigned simd_fnv1 (const void *, size_t size, unsigned basis,
+                    unsigned prime);
+unsigned simd_crc32c (const void *, size_t size, unsigned crc);
+
+#endif /* simd.h */